@@ -0,0 +1,394 @@
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief benchmark suite for the hot cvector operations
+ * @file bench.c
+ *
+ * Every (operation, growth mode, element size, element count) combination is
+ * run in a forked child so that the reported peak RSS belongs to that case
+ * alone. Results are written as CSV, and a previous CSV can be passed with
+ * --baseline to flag cases which got slower than --threshold allows.
+ */
+#include "bench.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+bench_alloc_stats_t bench_alloc_stats;
+
+static const char *bench_ops[] = {
+    "push_back",
+    "append_n",
+    "insert",
+    "erase",
+    "copy",
+    "resize_grow",
+    "resize_zero",
+    "resize_shrink",
+};
+
+static const size_t bench_elem_sizes[] = {1, 8, 64, 256};
+
+static const bench_growth_t *bench_growths[] = {
+    &bench_growth_double,
+    &bench_growth_linear,
+    &bench_growth_1_5,
+    &bench_growth_hybrid,
+};
+
+#define BENCH_COUNTOF(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef struct bench_options_t {
+    const char *ops;
+    const char *growths;
+    const char *elem_sizes;
+    size_t min_n;
+    size_t max_n;
+    size_t linear_max_n;
+    size_t max_bytes;
+    size_t repeat;
+    const char *output;
+    const char *baseline;
+    double threshold;
+    bench_params_t params;
+} bench_options_t;
+
+typedef struct bench_baseline_row_t {
+    char op[32];
+    char growth[32];
+    size_t elem_size;
+    size_t n;
+    double ns_per_op;
+} bench_baseline_row_t;
+
+double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench_usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --ops LIST           comma separated operations (default: all)\n"
+            "                       push_back,append_n,insert,erase,copy,resize_grow,\n"
+            "                       resize_zero,resize_shrink\n"
+            "  --growth LIST        comma separated growth modes (default: all)\n"
+            "                       double,linear,1.5x,hybrid\n"
+            "  --elem-sizes LIST    comma separated element sizes (default: 1,8,64,256)\n"
+            "  --min-n N            smallest element count (default: 10)\n"
+            "  --max-n N            largest element count (default: 100000000)\n"
+            "  --linear-max-n N     largest element count for linear growth (default: 100000)\n"
+            "  --max-bytes N        skip cases whose data exceeds N bytes (default: 268435456)\n"
+            "  --work-bytes N       element bytes touched per measurement (default: 16777216)\n"
+            "  --max-inserts N      insert/erase calls per vector (default: 1000)\n"
+            "  --repeat N           report the best of N runs (default: 3)\n"
+            "  --output FILE        write the CSV report to FILE instead of stdout\n"
+            "  --baseline FILE      compare against a previous CSV report\n"
+            "  --threshold F        allowed slowdown against the baseline (default: 0.10)\n",
+            argv0);
+}
+
+/* returns non-zero if `name` is an element of the comma separated `list` */
+static int bench_in_list(const char *list, const char *name) {
+    const size_t len = strlen(name);
+    const char *p    = list;
+
+    while (p && *p) {
+        const char *end = strchr(p, ',');
+        size_t n        = end ? (size_t)(end - p) : strlen(p);
+        if (n == len && strncmp(p, name, len) == 0) {
+            return 1;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+static int bench_parse_size(const char *s, size_t *out) {
+    char *end;
+    double v;
+
+    errno = 0;
+    v     = strtod(s, &end);
+    if (errno || end == s || *end != '\0' || v < 0) {
+        return -1;
+    }
+    *out = (size_t)v;
+    return 0;
+}
+
+static bench_baseline_row_t *bench_load_baseline(const char *path, size_t *count) {
+    char line[512];
+    size_t cap                 = 0;
+    bench_baseline_row_t *rows = NULL;
+    FILE *f                    = fopen(path, "r");
+
+    *count = 0;
+    if (!f) {
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), f)) {
+        bench_baseline_row_t row;
+        size_t reps;
+        if (sscanf(line, "%31[^,],%31[^,],%zu,%zu,%zu,%lf", row.op, row.growth, &row.elem_size, &row.n, &reps, &row.ns_per_op) != 6) {
+            /* header or malformed line */
+            continue;
+        }
+        if (*count == cap) {
+            bench_baseline_row_t *p;
+            cap = cap ? cap * 2 : 64;
+            p   = realloc(rows, cap * sizeof(*rows));
+            if (!p) {
+                break;
+            }
+            rows = p;
+        }
+        rows[(*count)++] = row;
+    }
+
+    fclose(f);
+    return rows;
+}
+
+static const bench_baseline_row_t *bench_find_baseline(const bench_baseline_row_t *rows, size_t count, const char *op, const char *growth, size_t elem_size, size_t n) {
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        if (rows[i].elem_size == elem_size && rows[i].n == n && strcmp(rows[i].op, op) == 0 && strcmp(rows[i].growth, growth) == 0) {
+            return &rows[i];
+        }
+    }
+    return NULL;
+}
+
+/* runs one case in a child process, returns the peak RSS of the child in KiB */
+static int bench_run_case(const bench_growth_t *growth, const char *op, size_t elem_size, size_t n, const bench_options_t *options, bench_result_t *result, long *peak_rss_kb) {
+    int fds[2];
+    int status;
+    pid_t pid;
+    ssize_t got;
+    struct rusage usage;
+
+    if (pipe(fds) != 0) {
+        return -1;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        bench_result_t best;
+        size_t i;
+
+        close(fds[0]);
+        memset(&best, 0, sizeof(best));
+        for (i = 0; i < options->repeat; ++i) {
+            bench_result_t current;
+            if (growth->run(op, elem_size, n, &options->params, &current) != 0) {
+                _exit(EXIT_FAILURE);
+            }
+            if (i == 0 || current.ns_per_op < best.ns_per_op) {
+                best = current;
+            }
+        }
+        if (write(fds[1], &best, sizeof(best)) != (ssize_t)sizeof(best)) {
+            _exit(EXIT_FAILURE);
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    got = read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+
+    if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || got != (ssize_t)sizeof(*result)) {
+        return -1;
+    }
+
+#ifdef __APPLE__
+    /* reported in bytes on macOS, KiB everywhere else */
+    *peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    *peak_rss_kb = usage.ru_maxrss;
+#endif
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    bench_options_t options;
+    bench_baseline_row_t *baseline = NULL;
+    size_t baseline_count          = 0;
+    size_t regressions             = 0;
+    FILE *out                      = stdout;
+    size_t g;
+    size_t o;
+    size_t e;
+    size_t n;
+    int i;
+
+    options.ops                = NULL;
+    options.growths            = NULL;
+    options.elem_sizes         = NULL;
+    options.min_n              = 10;
+    options.max_n              = 100000000;
+    options.linear_max_n       = 100000;
+    options.max_bytes          = (size_t)256 << 20;
+    options.repeat             = 3;
+    options.output             = NULL;
+    options.baseline           = NULL;
+    options.threshold          = 0.10;
+    options.params.work_bytes  = (size_t)16 << 20;
+    options.params.max_inserts = 1000;
+
+    for (i = 1; i < argc; ++i) {
+        const char *arg   = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int ok            = value != NULL;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            bench_usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (strcmp(arg, "--ops") == 0) {
+            options.ops = value;
+        } else if (strcmp(arg, "--growth") == 0) {
+            options.growths = value;
+        } else if (strcmp(arg, "--elem-sizes") == 0) {
+            options.elem_sizes = value;
+        } else if (strcmp(arg, "--min-n") == 0) {
+            ok = ok && bench_parse_size(value, &options.min_n) == 0;
+        } else if (strcmp(arg, "--max-n") == 0) {
+            ok = ok && bench_parse_size(value, &options.max_n) == 0;
+        } else if (strcmp(arg, "--linear-max-n") == 0) {
+            ok = ok && bench_parse_size(value, &options.linear_max_n) == 0;
+        } else if (strcmp(arg, "--max-bytes") == 0) {
+            ok = ok && bench_parse_size(value, &options.max_bytes) == 0;
+        } else if (strcmp(arg, "--work-bytes") == 0) {
+            ok = ok && bench_parse_size(value, &options.params.work_bytes) == 0;
+        } else if (strcmp(arg, "--max-inserts") == 0) {
+            ok = ok && bench_parse_size(value, &options.params.max_inserts) == 0;
+        } else if (strcmp(arg, "--repeat") == 0) {
+            ok = ok && bench_parse_size(value, &options.repeat) == 0;
+        } else if (strcmp(arg, "--output") == 0) {
+            options.output = value;
+        } else if (strcmp(arg, "--baseline") == 0) {
+            options.baseline = value;
+        } else if (strcmp(arg, "--threshold") == 0) {
+            ok = ok && sscanf(value, "%lf", &options.threshold) == 1;
+        } else {
+            ok = 0;
+        }
+
+        if (!ok) {
+            fprintf(stderr, "invalid argument: %s\n", arg);
+            bench_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        ++i;
+    }
+
+    if (options.min_n == 0 || options.repeat == 0 || options.params.work_bytes == 0 || options.params.max_inserts == 0) {
+        fprintf(stderr, "--min-n, --repeat, --work-bytes and --max-inserts must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    if (options.baseline) {
+        baseline = bench_load_baseline(options.baseline, &baseline_count);
+        if (!baseline) {
+            fprintf(stderr, "could not read baseline: %s\n", options.baseline);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.output) {
+        out = fopen(options.output, "w");
+        if (!out) {
+            fprintf(stderr, "could not open output: %s\n", options.output);
+            free(baseline);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(out, "op,growth,elem_size,n,reps,ns_per_op,allocs,reallocs,peak_rss_kb%s\n", baseline ? ",baseline_ns_per_op,change_pct" : "");
+
+    for (o = 0; o < BENCH_COUNTOF(bench_ops); ++o) {
+        if (options.ops && !bench_in_list(options.ops, bench_ops[o])) {
+            continue;
+        }
+        for (g = 0; g < BENCH_COUNTOF(bench_growths); ++g) {
+            const bench_growth_t *growth = bench_growths[g];
+            size_t max_n                 = options.max_n;
+
+            if (options.growths && !bench_in_list(options.growths, growth->name)) {
+                continue;
+            }
+            if (growth == &bench_growth_linear && max_n > options.linear_max_n) {
+                max_n = options.linear_max_n;
+            }
+
+            for (e = 0; e < BENCH_COUNTOF(bench_elem_sizes); ++e) {
+                const size_t elem_size = bench_elem_sizes[e];
+                char elem_name[32];
+
+                sprintf(elem_name, "%zu", elem_size);
+                if (options.elem_sizes && !bench_in_list(options.elem_sizes, elem_name)) {
+                    continue;
+                }
+
+                for (n = options.min_n; n <= max_n && n <= options.max_bytes / elem_size; n *= 10) {
+                    bench_result_t result;
+                    long peak_rss_kb;
+                    const bench_baseline_row_t *base;
+
+                    if (bench_run_case(growth, bench_ops[o], elem_size, n, &options, &result, &peak_rss_kb) != 0) {
+                        fprintf(stderr, "failed: %s,%s,%zu,%zu\n", bench_ops[o], growth->name, elem_size, n);
+                        continue;
+                    }
+
+                    fprintf(out, "%s,%s,%zu,%zu,%zu,%.3f,%zu,%zu,%ld", bench_ops[o], growth->name, elem_size, n, result.reps, result.ns_per_op, result.allocs, result.reallocs, peak_rss_kb);
+
+                    base = baseline ? bench_find_baseline(baseline, baseline_count, bench_ops[o], growth->name, elem_size, n) : NULL;
+                    if (base) {
+                        const double change = base->ns_per_op > 0 ? (result.ns_per_op / base->ns_per_op - 1.0) : 0.0;
+                        fprintf(out, ",%.3f,%.1f", base->ns_per_op, change * 100.0);
+                        if (change > options.threshold) {
+                            fprintf(stderr, "regression: %s,%s,%zu,%zu: %.3f -> %.3f ns/op (%+.1f%%)\n", bench_ops[o], growth->name, elem_size, n, base->ns_per_op, result.ns_per_op, change * 100.0);
+                            ++regressions;
+                        }
+                    } else if (baseline) {
+                        fprintf(out, ",,");
+                    }
+                    fputc('\n', out);
+                    fflush(out);
+
+                    if (n > (size_t)-1 / 10) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(baseline);
+
+    if (regressions) {
+        fprintf(stderr, "%zu case(s) regressed by more than %.1f%%\n", regressions, options.threshold * 100.0);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
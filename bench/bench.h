@@ -0,0 +1,58 @@
+#ifndef CVECTOR_BENCH_H_
+#define CVECTOR_BENCH_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief shared declarations for the cvector benchmark suite
+ * @file bench.h
+ */
+
+#include <stddef.h>
+
+/* allocation counters, updated by the allocator hooks of every growth mode */
+typedef struct bench_alloc_stats_t {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+} bench_alloc_stats_t;
+
+extern bench_alloc_stats_t bench_alloc_stats;
+
+/* tunables shared by every workload */
+typedef struct bench_params_t {
+    size_t work_bytes;  /* amount of element data touched per measurement */
+    size_t max_inserts; /* upper bound on insert/erase calls per vector */
+} bench_params_t;
+
+typedef struct bench_result_t {
+    double ns_per_op;
+    size_t reps;
+    size_t allocs;
+    size_t reallocs;
+} bench_result_t;
+
+/**
+ * @brief runs a single workload
+ * @param op - name of the operation (see bench_ops in bench.c)
+ * @param elem_size - element size in bytes, one of 1, 8, 64 or 256
+ * @param n - number of elements in the vector
+ * @param params - shared tunables
+ * @param result - receives the measurement
+ * @return 0 on success, -1 if the combination is not supported
+ */
+typedef int (*bench_run_fn)(const char *op, size_t elem_size, size_t n, const bench_params_t *params, bench_result_t *result);
+
+typedef struct bench_growth_t {
+    const char *name;
+    bench_run_fn run;
+} bench_growth_t;
+
+/* one instance per growth policy of cvector.h */
+extern const bench_growth_t bench_growth_double;
+extern const bench_growth_t bench_growth_linear;
+extern const bench_growth_t bench_growth_1_5;
+extern const bench_growth_t bench_growth_hybrid;
+
+double bench_now_ns(void);
+
+#endif /* CVECTOR_BENCH_H_ */
@@ -0,0 +1,82 @@
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief instantiates every workload for one growth mode
+ * @file bench_growth.h
+ */
+
+/* NOTE: there is intentionally no include guard, every growth mode translation
+ * unit includes this exactly once after defining BENCH_GROWTH_NAME and
+ * BENCH_GROWTH_SYMBOL (and whatever selects the growth policy).
+ */
+#include "bench.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* count every trip into the allocator so that the report can show how many
+ * (re)allocations each workload needs */
+static void *bench_malloc(size_t size) {
+    ++bench_alloc_stats.mallocs;
+    return malloc(size);
+}
+
+static void *bench_calloc(size_t count, size_t size) {
+    ++bench_alloc_stats.mallocs;
+    return calloc(count, size);
+}
+
+static void *bench_realloc(void *ptr, size_t size) {
+    ++bench_alloc_stats.reallocs;
+    return realloc(ptr, size);
+}
+
+static void bench_free(void *ptr) {
+    ++bench_alloc_stats.frees;
+    free(ptr);
+}
+
+#define cvector_clib_malloc bench_malloc
+#define cvector_clib_realloc bench_realloc
+#define cvector_clib_free bench_free
+#define cvector_clib_calloc bench_calloc
+
+#include "cvector.h"
+
+#define BENCH_CAT_(a, b) a##b
+#define BENCH_CAT(a, b) BENCH_CAT_(a, b)
+
+/* defeats dead code elimination of the timed loops */
+static volatile unsigned char bench_sink;
+
+#define BENCH_ELEM_BYTES 1
+#include "bench_ops.h"
+#undef BENCH_ELEM_BYTES
+
+#define BENCH_ELEM_BYTES 8
+#include "bench_ops.h"
+#undef BENCH_ELEM_BYTES
+
+#define BENCH_ELEM_BYTES 64
+#include "bench_ops.h"
+#undef BENCH_ELEM_BYTES
+
+#define BENCH_ELEM_BYTES 256
+#include "bench_ops.h"
+#undef BENCH_ELEM_BYTES
+
+static int bench_run(const char *op, size_t elem_size, size_t n, const bench_params_t *params, bench_result_t *result) {
+    switch (elem_size) {
+    case 1:
+        return bench_run_1(op, n, params, result);
+    case 8:
+        return bench_run_8(op, n, params, result);
+    case 64:
+        return bench_run_64(op, n, params, result);
+    case 256:
+        return bench_run_256(op, n, params, result);
+    default:
+        return -1;
+    }
+}
+
+const bench_growth_t BENCH_GROWTH_SYMBOL = {BENCH_GROWTH_NAME, bench_run};
@@ -0,0 +1,151 @@
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief workload template for the cvector benchmark suite
+ * @file bench_ops.h
+ */
+
+/* NOTE: there is intentionally no include guard, this file is instantiated
+ * once per element size by bench_growth.h, which defines BENCH_ELEM_BYTES
+ * before each inclusion.
+ */
+#ifndef BENCH_ELEM_BYTES
+#error "BENCH_ELEM_BYTES must be defined before including bench_ops.h"
+#endif
+
+#define BENCH_T BENCH_CAT(bench_elem_, BENCH_ELEM_BYTES)
+
+/* number of elements appended per cvector_append_n call */
+#ifndef BENCH_APPEND_BATCH
+#define BENCH_APPEND_BATCH 4096
+#endif
+
+typedef struct {
+    unsigned char bytes[BENCH_ELEM_BYTES];
+} BENCH_T;
+
+static int BENCH_CAT(bench_run_, BENCH_ELEM_BYTES)(const char *op, size_t n, const bench_params_t *params, bench_result_t *result) {
+    const size_t bytes = n * sizeof(BENCH_T);
+    size_t reps        = bytes < params->work_bytes ? params->work_bytes / bytes : 1;
+    size_t inserts     = n < params->max_inserts ? n : params->max_inserts;
+    size_t ops         = 0;
+    size_t r;
+    size_t i;
+    double start;
+    double elapsed;
+    bench_alloc_stats_t before;
+    BENCH_T proto;
+    BENCH_T *batch;
+    cvector_vector_type(BENCH_T) *vecs;
+    cvector_vector_type(BENCH_T) *copies;
+
+    /* keep the amount of memmove traffic of the insert/erase workloads
+     * bounded for very large vectors */
+    if (inserts > 2 * params->work_bytes / bytes) {
+        inserts = 2 * params->work_bytes / bytes;
+    }
+    if (inserts == 0) {
+        inserts = 1;
+    }
+
+    memset(&proto, 0xa5, sizeof(proto));
+    vecs   = calloc(reps, sizeof(*vecs));
+    copies = calloc(reps, sizeof(*copies));
+    batch  = malloc(BENCH_APPEND_BATCH * sizeof(*batch));
+    if (!vecs || !copies || !batch) {
+        free(vecs);
+        free(copies);
+        free(batch);
+        return -1;
+    }
+    for (i = 0; i < BENCH_APPEND_BATCH; ++i) {
+        batch[i] = proto;
+    }
+
+    /* set up the vectors which the timed section operates on */
+    if (strcmp(op, "insert") == 0 || strcmp(op, "erase") == 0 || strcmp(op, "copy") == 0) {
+        for (r = 0; r < reps; ++r) {
+            for (i = 0; i < n; ++i) {
+                cvector_push_back(vecs[r], proto);
+            }
+        }
+    } else if (strcmp(op, "resize_shrink") == 0) {
+        for (r = 0; r < reps; ++r) {
+            cvector_resize(vecs[r], n, proto);
+        }
+    }
+
+    before = bench_alloc_stats;
+    start  = bench_now_ns();
+
+    if (strcmp(op, "push_back") == 0) {
+        for (r = 0; r < reps; ++r) {
+            for (i = 0; i < n; ++i) {
+                cvector_push_back(vecs[r], proto);
+            }
+        }
+        ops = reps * n;
+    } else if (strcmp(op, "append_n") == 0) {
+        for (r = 0; r < reps; ++r) {
+            for (i = 0; i < n; i += BENCH_APPEND_BATCH) {
+                cvector_append_n(vecs[r], batch, n - i < BENCH_APPEND_BATCH ? n - i : BENCH_APPEND_BATCH);
+            }
+        }
+        ops = reps * n;
+    } else if (strcmp(op, "insert") == 0) {
+        for (r = 0; r < reps; ++r) {
+            for (i = 0; i < inserts; ++i) {
+                cvector_insert(vecs[r], cvector_size(vecs[r]) / 2, proto);
+            }
+        }
+        ops = reps * inserts;
+    } else if (strcmp(op, "erase") == 0) {
+        for (r = 0; r < reps; ++r) {
+            for (i = 0; i < inserts; ++i) {
+                cvector_erase(vecs[r], cvector_size(vecs[r]) / 2);
+            }
+        }
+        ops = reps * inserts;
+    } else if (strcmp(op, "copy") == 0) {
+        for (r = 0; r < reps; ++r) {
+            cvector_copy(vecs[r], copies[r]);
+        }
+        ops = reps * n;
+    } else if (strcmp(op, "resize_grow") == 0) {
+        for (r = 0; r < reps; ++r) {
+            cvector_resize(vecs[r], n, proto);
+        }
+        ops = reps * n;
+    } else if (strcmp(op, "resize_zero") == 0) {
+        for (r = 0; r < reps; ++r) {
+            cvector_resize_zero(vecs[r], n);
+        }
+        ops = reps * n;
+    } else if (strcmp(op, "resize_shrink") == 0) {
+        for (r = 0; r < reps; ++r) {
+            cvector_resize(vecs[r], 0, proto);
+        }
+        ops = reps * n;
+    }
+
+    elapsed = bench_now_ns() - start;
+
+    result->ns_per_op = ops ? elapsed / (double)ops : 0.0;
+    result->reps      = reps;
+    result->allocs    = (bench_alloc_stats.mallocs - before.mallocs) / reps;
+    result->reallocs  = (bench_alloc_stats.reallocs - before.reallocs) / reps;
+
+    for (r = 0; r < reps; ++r) {
+        if (cvector_size(vecs[r]) != 0) {
+            bench_sink ^= vecs[r][0].bytes[0];
+        }
+        cvector_free(vecs[r]);
+        cvector_free(copies[r]);
+    }
+    free(vecs);
+    free(copies);
+    free(batch);
+    return ops ? 0 : -1;
+}
+
+#undef BENCH_T
@@ -0,0 +1,5 @@
+/* capacity grows by half of itself each time the vector runs out of space */
+#define CVECTOR_GROWTH_FACTOR_1_5
+#define BENCH_GROWTH_NAME "1.5x"
+#define BENCH_GROWTH_SYMBOL bench_growth_1_5
+#include "bench_growth.h"
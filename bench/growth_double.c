@@ -0,0 +1,4 @@
+/* default growth: capacity doubles each time the vector runs out of space */
+#define BENCH_GROWTH_NAME "double"
+#define BENCH_GROWTH_SYMBOL bench_growth_double
+#include "bench_growth.h"
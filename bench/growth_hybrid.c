@@ -0,0 +1,5 @@
+/* capacity doubles up to CVECTOR_HYBRID_GROWTH_THRESHOLD bytes, then grows in fixed chunks */
+#define CVECTOR_HYBRID_GROWTH
+#define BENCH_GROWTH_NAME "hybrid"
+#define BENCH_GROWTH_SYMBOL bench_growth_hybrid
+#include "bench_growth.h"
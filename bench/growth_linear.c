@@ -0,0 +1,5 @@
+/* capacity increases by one each time the vector runs out of space */
+#define CVECTOR_LINEAR_GROWTH
+#define BENCH_GROWTH_NAME "linear"
+#define BENCH_GROWTH_SYMBOL bench_growth_linear
+#include "bench_growth.h"
@@ -30,6 +30,12 @@
 #define cvector_clib_calloc calloc
 #define cvector_clib_realloc realloc
 #endif
+/* optional, returns how many bytes cvector_clib_malloc really provides for a
+ * request of `size` bytes (for example nallocx() with jemalloc), which lets a
+ * growing vector use all of it */
+#ifndef cvector_clib_good_size
+#define cvector_clib_good_size(size) (size)
+#endif
 /* functions independent of memory allocation */
 #ifndef cvector_clib_assert
 #include <assert.h> /* for assert */
@@ -43,6 +49,10 @@
 #include <string.h> /* for memmove */
 #define cvector_clib_memmove memmove
 #endif
+#ifndef cvector_clib_memset
+#include <string.h> /* for memset */
+#define cvector_clib_memset memset
+#endif
 
 /* NOTE: Similar to C's qsort and bsearch, you will receive a T*
  * for a vector of Ts. This means that you cannot use `free` directly
@@ -56,10 +66,48 @@
  */
 typedef void (*cvector_elem_destructor_t)(void *elem_ptr);
 
+/* NOTE: by default every vector allocates through the cvector_clib_* functions
+ * above. A vector can instead carry its own allocator, which lets vectors in
+ * the same translation unit use different memory sources (for example a
+ * request scoped arena for short lived vectors and the heap for the rest).
+ *
+ * Every callback receives `ctx`. Because a vector always knows how large its
+ * block is, the current size of the block is passed to `realloc_fn` and
+ * `free_fn`, so allocators do not need to keep per block headers of their own.
+ * `malloc_fn` and `realloc_fn` return NULL on failure.
+ *
+ * The allocator is referenced, not copied, so it must outlive every vector
+ * using it.
+ */
+typedef struct cvector_allocator_t {
+    void *(*malloc_fn)(void *ctx, size_t size);
+    void *(*realloc_fn)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free_fn)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+    /* optional, returns how many bytes the allocator really provides for a request of `size` bytes,
+     * or the most it can provide if that is less */
+    size_t (*good_size_fn)(void *ctx, size_t size);
+} cvector_allocator_t;
+
+/* the storage of the vector was provided by the caller (see cvector_init_inline),
+ * it is never resized or released, the vector moves to the heap once it outgrows it */
+#define CVECTOR_FLAG_NOT_OWNED 0x1u
+
+/* the vector allocates through a cvector_allocator_t, and a pointer to it is
+ * stored at the start of the block, in front of the metadata */
+#define CVECTOR_FLAG_ALLOCATOR 0x2u
+
+/* NOTE: the metadata only has room for what most vectors use. Everything else
+ * is packed into `layout`, which is 0 for a vector using the cvector_clib_*
+ * functions: the low 2 bits hold the CVECTOR_FLAG_* flags, the next 6 bits the
+ * log2 of the alignment of the elements (see cvector_init_aligned), and the
+ * remaining bits the offset of the metadata from the start of its block.
+ */
 typedef struct cvector_metadata_t {
     size_t size;
     size_t capacity;
     cvector_elem_destructor_t elem_destructor;
+    size_t layout;
 } cvector_metadata_t;
 
 /**
@@ -98,6 +146,102 @@ typedef struct cvector_metadata_t {
 #define cvector_base_to_vec(ptr) \
     ((void *)&((cvector_metadata_t *)(ptr))[1])
 
+/**
+ * @brief cvector_make_layout - For internal use, packs the layout word of the metadata
+ * @param flags - the CVECTOR_FLAG_* flags
+ * @param shift - log2 of the alignment of the elements
+ * @param offset - the offset of the metadata from the start of its block
+ * @return the layout as a size_t
+ * @internal
+ */
+#define cvector_make_layout(flags, shift, offset) \
+    ((size_t)(flags) | ((size_t)(shift) << 2) | ((size_t)(offset) << 8))
+
+/**
+ * @brief cvector_layout_flags - For internal use, gets the CVECTOR_FLAG_* flags of a vector
+ * @param vec - the vector, which must not be NULL
+ * @return the flags as a size_t
+ * @internal
+ */
+#define cvector_layout_flags(vec) \
+    (cvector_vec_to_base(vec)->layout & 0x3u)
+
+/**
+ * @brief cvector_layout_shift - For internal use, gets the log2 of the alignment of the elements of a vector
+ * @param vec - the vector, which must not be NULL
+ * @return the shift as a size_t
+ * @internal
+ */
+#define cvector_layout_shift(vec) \
+    ((cvector_vec_to_base(vec)->layout >> 2) & 0x3fu)
+
+/**
+ * @brief cvector_layout_offset - For internal use, gets the offset of the metadata of a vector from the start of its block
+ * @param vec - the vector, which must not be NULL
+ * @return the offset in bytes as a size_t
+ * @internal
+ */
+#define cvector_layout_offset(vec) \
+    (cvector_vec_to_base(vec)->layout >> 8)
+
+/**
+ * @brief cvector_set_metadata - For internal use, initializes all of the metadata at `base`
+ * @param base - pointer to the cvector_metadata_t
+ * @param sz - the size
+ * @param cap - the capacity
+ * @param elem_destructor_fn - element destructor function
+ * @param layout_word - the layout, see cvector_make_layout
+ * @return void
+ * @internal
+ */
+#define cvector_set_metadata(base, sz, cap, elem_destructor_fn, layout_word)               \
+    do {                                                                                   \
+        cvector_metadata_t *cv_set_metadata_p__                = (base);                   \
+        const size_t cv_set_metadata_sz__                      = (sz);                     \
+        const size_t cv_set_metadata_cap__                     = (cap);                    \
+        const cvector_elem_destructor_t cv_set_metadata_dtor__ = (elem_destructor_fn);     \
+        const size_t cv_set_metadata_layout__                  = (layout_word);            \
+        cv_set_metadata_p__->size                              = cv_set_metadata_sz__;     \
+        cv_set_metadata_p__->capacity                          = cv_set_metadata_cap__;    \
+        cv_set_metadata_p__->elem_destructor                   = cv_set_metadata_dtor__;   \
+        cv_set_metadata_p__->layout                            = cv_set_metadata_layout__; \
+    } while (0)
+
+/**
+ * @brief cvector_align_shift - For internal use, computes the log2 of a power of two
+ * @param align - the power of two
+ * @param shift - an lvalue of type size_t which receives the log2
+ * @return void
+ * @internal
+ */
+#define cvector_align_shift(align, shift)                         \
+    do {                                                          \
+        const size_t cv_align_shift_align__ = (size_t)(align);    \
+        (shift)                             = 0;                  \
+        while (((size_t)1 << (shift)) < cv_align_shift_align__) { \
+            ++(shift);                                            \
+        }                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_vec_to_block - For internal use, converts a vector pointer to a pointer to the start of its block
+ * @param vec - the vector
+ * @return the pointer which was returned by the allocator
+ * @internal
+ */
+#define cvector_vec_to_block(vec) \
+    ((void *)((char *)cvector_vec_to_base(vec) - cvector_layout_offset(vec)))
+
+/**
+ * @brief cvector_block_prefix - For internal use, the bytes at the start of a block in front of the
+ * padding and the metadata, which hold the pointer to the allocator if there is one
+ * @param alloc - the allocator, or NULL
+ * @return the size of the prefix as a size_t
+ * @internal
+ */
+#define cvector_block_prefix(alloc) \
+    ((alloc) ? sizeof(const cvector_allocator_t *) : (size_t)0)
+
 /**
  * @brief cvector_capacity - gets the current capacity of the vector
  * @param vec - the vector
@@ -123,6 +267,32 @@ typedef struct cvector_metadata_t {
 #define cvector_elem_destructor(vec) \
     ((vec) ? cvector_vec_to_base(vec)->elem_destructor : NULL)
 
+/**
+ * @brief cvector_allocator - get the allocator used for the storage of the vector
+ * @param vec - the vector
+ * @return a pointer to the cvector_allocator_t, or NULL if the cvector_clib_* functions are used
+ */
+#define cvector_allocator(vec)                                                          \
+    (((vec) && (cvector_layout_flags(vec) & CVECTOR_FLAG_ALLOCATOR))                    \
+         ? *(const cvector_allocator_t *const *)(const void *)cvector_vec_to_block(vec) \
+         : (const cvector_allocator_t *)NULL)
+
+/**
+ * @brief cvector_alignment - get the alignment of the elements of the vector
+ * @param vec - the vector
+ * @return the alignment requested with cvector_init_aligned, or 1 for any other vector
+ */
+#define cvector_alignment(vec) \
+    ((vec) ? (size_t)1 << cvector_layout_shift(vec) : (size_t)1)
+
+/**
+ * @brief cvector_owns_storage - returns non-zero if the storage of the vector was allocated by the vector itself
+ * @param vec - the vector
+ * @return zero if the vector still lives in caller provided storage (see cvector_init_inline), non-zero otherwise
+ */
+#define cvector_owns_storage(vec) \
+    ((vec) ? !(cvector_layout_flags(vec) & CVECTOR_FLAG_NOT_OWNED) : 1)
+
 /**
  * @brief cvector_empty - returns non-zero if the vector is empty
  * @param vec - the vector
@@ -163,6 +333,134 @@ typedef struct cvector_metadata_t {
         }                                                             \
     } while (0)
 
+/**
+ * @brief cvector_init_with_allocator - Initialize a vector which allocates its storage through `alloc`.
+ * Unlike cvector_init, the vector is always allocated (even for a capacity of zero) so that
+ * it can remember its allocator. The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @param alloc - pointer to the cvector_allocator_t to use, NULL selects the cvector_clib_* functions
+ * @return void
+ */
+#define cvector_init_with_allocator(vec, capacity, elem_destructor_fn, alloc) \
+    do {                                                                      \
+        if (!(vec)) {                                                         \
+            cvector_allocate((vec), (capacity), 1, (alloc));                  \
+            cvector_set_elem_destructor((vec), (elem_destructor_fn));         \
+        }                                                                     \
+    } while (0)
+
+/**
+ * @brief cvector_init_aligned - Initialize a vector whose first element is aligned to `alignment` bytes,
+ * for example 32 for AVX loads or 64 to keep elements from straddling cache lines. The alignment is
+ * kept when the vector grows or shrinks, at the cost of up to `alignment - 1` unused bytes per block.
+ * Like cvector_init_with_allocator, the vector is always allocated. The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param alignment - the alignment in bytes, a power of two
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_aligned(vec, capacity, alignment, elem_destructor_fn)                                                                              \
+    do {                                                                                                                                                \
+        if (!(vec)) {                                                                                                                                   \
+            cvector_clib_assert((alignment) > 0 && ((size_t)(alignment) & ((size_t)(alignment) - 1)) == 0 && (size_t)(alignment) <= ((size_t)-1 >> 9)); \
+            cvector_allocate((vec), (capacity), (alignment), NULL);                                                                                     \
+            cvector_set_elem_destructor((vec), (elem_destructor_fn));                                                                                   \
+        }                                                                                                                                               \
+    } while (0)
+
+/**
+ * @brief cvector_type_align - For internal use, the alignment of `type`, which is where a member of
+ * that type is placed after a char
+ * @param type - the type
+ * @return the alignment as a size_t
+ * @internal
+ */
+#define cvector_type_align(type) \
+    (sizeof(struct { char c; type t; }) - sizeof(type))
+
+/**
+ * @brief cvector_inline_header_size - For internal use, the bytes of inline storage in front of the
+ * elements: the metadata, preceded by padding if `align` is larger than the metadata
+ * @param align - the alignment of the elements
+ * @return the size in bytes as a size_t
+ * @internal
+ */
+#define cvector_inline_header_size(align) \
+    ((sizeof(cvector_metadata_t) + (align) - 1) / (align) * (align))
+
+/**
+ * @brief cvector_inline_storage - declares storage suitable for cvector_init_inline,
+ * with room for `count` elements of `type` and the vector's metadata. It can be a
+ * local variable or a member of another struct. The storage is aligned for `type`,
+ * so over-aligned element types are placed correctly as well.
+ * ex: cvector_inline_storage(int, 8) buf;
+ * @param type - the element type of the vector
+ * @param count - the number of elements which fit in the storage
+ */
+#define cvector_inline_storage(type, count)                                                                 \
+    union {                                                                                                 \
+        cvector_metadata_t metadata;                                                                        \
+        struct {                                                                                            \
+            char c;                                                                                         \
+            type elem;                                                                                      \
+        } align;                                                                                            \
+        unsigned char bytes[cvector_inline_header_size(cvector_type_align(type)) + (count) * sizeof(type)]; \
+    }
+
+/**
+ * @brief cvector_init_inline - Initialize a vector which keeps its first elements in caller provided storage
+ * declared with cvector_inline_storage. Nothing is allocated until the vector outgrows the storage, at which
+ * point it moves to the heap. The storage must outlive the vector and the vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param storage - the storage (not a pointer to it)
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_inline(vec, storage, elem_destructor_fn)                                                                             \
+    cvector_init_storage((vec), (storage).bytes, sizeof(storage),                                                                         \
+                         cvector_inline_header_size(sizeof((storage).align) - sizeof((storage).align.elem)) - sizeof(cvector_metadata_t), \
+                         (elem_destructor_fn))
+
+/**
+ * @brief cvector_init_buffer - Initialize a vector in a caller provided buffer of `size` bytes, which must be
+ * suitably aligned for cvector_metadata_t and, when the metadata is followed by the elements, for the elements.
+ * Behaves like cvector_init_inline.
+ * @param vec - the vector
+ * @param buffer - pointer to the buffer
+ * @param size - size of the buffer in bytes, at least sizeof(cvector_metadata_t)
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_buffer(vec, buffer, size, elem_destructor_fn) \
+    cvector_init_storage((vec), (buffer), (size), 0, (elem_destructor_fn))
+
+/**
+ * @brief cvector_init_storage - For internal use, initializes a vector whose metadata is placed `offset`
+ * bytes into a caller provided buffer of `size` bytes
+ * @param vec - the vector
+ * @param buffer - pointer to the buffer
+ * @param size - size of the buffer in bytes
+ * @param offset - padding in front of the metadata
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ * @internal
+ */
+#define cvector_init_storage(vec, buffer, size, offset, elem_destructor_fn)                                              \
+    do {                                                                                                                 \
+        if (!(vec)) {                                                                                                    \
+            const size_t cv_init_storage_off__ = (size_t)(offset);                                                       \
+            cvector_clib_assert((size_t)(size) >= cv_init_storage_off__ + sizeof(cvector_metadata_t));                   \
+            (vec) = cvector_base_to_vec((unsigned char *)(buffer) + cv_init_storage_off__);                              \
+            cvector_set_metadata(cvector_vec_to_base(vec), 0,                                                            \
+                                 ((size_t)(size) - cv_init_storage_off__ - sizeof(cvector_metadata_t)) / sizeof(*(vec)), \
+                                 (elem_destructor_fn),                                                                   \
+                                 cvector_make_layout(CVECTOR_FLAG_NOT_OWNED, 0, cv_init_storage_off__));                 \
+        }                                                                                                                \
+    } while (0)
+
 /**
  * @brief cvector_erase - removes the element at index i from the vector
  * @param vec - the vector
@@ -187,6 +485,106 @@ typedef struct cvector_metadata_t {
         }                                                                                      \
     } while (0)
 
+/**
+ * @brief cvector_erase_unordered - removes the element at index i from the vector in O(1) by moving
+ * the last element into its place, so the order of the remaining elements is not preserved
+ * @param vec - the vector
+ * @param i - index of element to remove
+ * @return void
+ */
+#define cvector_erase_unordered(vec, i)                                                                  \
+    do {                                                                                                 \
+        if (vec) {                                                                                       \
+            const size_t cv_erase_unordered_i__  = (size_t)(i);                                          \
+            const size_t cv_erase_unordered_sz__ = cvector_size(vec);                                    \
+            if (cv_erase_unordered_i__ < cv_erase_unordered_sz__) {                                      \
+                cvector_elem_destructor_t cv_erase_unordered_elem_dtor__ = cvector_elem_destructor(vec); \
+                if (cv_erase_unordered_elem_dtor__) {                                                    \
+                    cv_erase_unordered_elem_dtor__(&(vec)[cv_erase_unordered_i__]);                      \
+                }                                                                                        \
+                if (cv_erase_unordered_i__ != cv_erase_unordered_sz__ - 1) {                             \
+                    (vec)[cv_erase_unordered_i__] = (vec)[cv_erase_unordered_sz__ - 1];                  \
+                }                                                                                        \
+                cvector_set_size((vec), cv_erase_unordered_sz__ - 1);                                    \
+            }                                                                                            \
+        }                                                                                                \
+    } while (0)
+
+/**
+ * @brief cvector_remove_if - removes every element for which `pred` returns non-zero in a single pass.
+ * The remaining elements keep their order, the removed ones are passed to the element destructor.
+ * @param vec - the vector
+ * @param pred - function (or function like macro) which receives an element, like with cvector_for_each
+ * @return void
+ */
+#define cvector_remove_if(vec, pred)                                                               \
+    do {                                                                                           \
+        if (vec) {                                                                                 \
+            cvector_elem_destructor_t cv_remove_if_elem_dtor__ = cvector_elem_destructor(vec);     \
+            const size_t cv_remove_if_sz__                     = cvector_size(vec);                \
+            size_t cv_remove_if_i__;                                                               \
+            size_t cv_remove_if_kept__ = 0;                                                        \
+            for (cv_remove_if_i__ = 0; cv_remove_if_i__ < cv_remove_if_sz__; ++cv_remove_if_i__) { \
+                if (pred((vec)[cv_remove_if_i__])) {                                               \
+                    if (cv_remove_if_elem_dtor__) {                                                \
+                        cv_remove_if_elem_dtor__(&(vec)[cv_remove_if_i__]);                        \
+                    }                                                                              \
+                } else {                                                                           \
+                    if (cv_remove_if_kept__ != cv_remove_if_i__) {                                 \
+                        (vec)[cv_remove_if_kept__] = (vec)[cv_remove_if_i__];                      \
+                    }                                                                              \
+                    ++cv_remove_if_kept__;                                                         \
+                }                                                                                  \
+            }                                                                                      \
+            cvector_set_size((vec), cv_remove_if_kept__);                                          \
+        }                                                                                          \
+    } while (0)
+
+/**
+ * @brief cvector_erase_range - removes the elements with indices in [first, last) from the vector.
+ * The destructor runs over the removed span, the tail is shifted with a single memmove and the size is written once.
+ * Nothing happens unless first <= last <= cvector_size(vec).
+ * @param vec - the vector
+ * @param first - index of the first element to remove
+ * @param last - index one past the last element to remove
+ * @return void
+ */
+#define cvector_erase_range(vec, first, last)                                                                     \
+    do {                                                                                                          \
+        if (vec) {                                                                                                \
+            const size_t cv_erase_range_first__ = (size_t)(first);                                                \
+            const size_t cv_erase_range_last__  = (size_t)(last);                                                 \
+            const size_t cv_erase_range_sz__    = cvector_size(vec);                                              \
+            if (cv_erase_range_first__ < cv_erase_range_last__ && cv_erase_range_last__ <= cv_erase_range_sz__) { \
+                cvector_destroy_range((vec), cv_erase_range_first__, cv_erase_range_last__);                      \
+                cvector_clib_memmove(                                                                             \
+                    (vec) + cv_erase_range_first__,                                                               \
+                    (vec) + cv_erase_range_last__,                                                                \
+                    sizeof(*(vec)) * (cv_erase_range_sz__ - cv_erase_range_last__));                              \
+                cvector_set_size((vec), cv_erase_range_sz__ - (cv_erase_range_last__ - cv_erase_range_first__));  \
+            }                                                                                                     \
+        }                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_truncate - removes all elements from index n onwards, if the vector has more than n elements.
+ * The destructor runs over the removed span and the size is written once, the capacity is unchanged.
+ * @param vec - the vector
+ * @param n - the new size of the vector
+ * @return void
+ */
+#define cvector_truncate(vec, n)                                                 \
+    do {                                                                         \
+        if (vec) {                                                               \
+            const size_t cv_truncate_n__  = (size_t)(n);                         \
+            const size_t cv_truncate_sz__ = cvector_size(vec);                   \
+            if (cv_truncate_n__ < cv_truncate_sz__) {                            \
+                cvector_destroy_range((vec), cv_truncate_n__, cv_truncate_sz__); \
+                cvector_set_size((vec), cv_truncate_n__);                        \
+            }                                                                    \
+        }                                                                        \
+    } while (0)
+
 /**
  * @brief cvector_clear - erase all of the elements in the vector
  * @param vec - the vector
@@ -211,19 +609,23 @@ typedef struct cvector_metadata_t {
  * @param vec - the vector
  * @return void
  */
-#define cvector_free(vec)                                                                 \
-    do {                                                                                  \
-        if (vec) {                                                                        \
-            void *cv_free_p__                             = cvector_vec_to_base(vec);     \
-            cvector_elem_destructor_t cv_free_elem_dtor__ = cvector_elem_destructor(vec); \
-            if (cv_free_elem_dtor__) {                                                    \
-                size_t cv_free_i__;                                                       \
-                for (cv_free_i__ = 0; cv_free_i__ < cvector_size(vec); ++cv_free_i__) {   \
-                    cv_free_elem_dtor__(&(vec)[cv_free_i__]);                             \
-                }                                                                         \
-            }                                                                             \
-            cvector_clib_free(cv_free_p__);                                               \
-        }                                                                                 \
+#define cvector_free(vec)                                                                                     \
+    do {                                                                                                      \
+        if (vec) {                                                                                            \
+            void *cv_free_p__                             = cvector_vec_to_block(vec);                        \
+            const cvector_allocator_t *cv_free_alloc__    = cvector_allocator(vec);                           \
+            const size_t cv_free_sz__                     = cvector_block_size((vec), cvector_capacity(vec)); \
+            cvector_elem_destructor_t cv_free_elem_dtor__ = cvector_elem_destructor(vec);                     \
+            if (cv_free_elem_dtor__) {                                                                        \
+                size_t cv_free_i__;                                                                           \
+                for (cv_free_i__ = 0; cv_free_i__ < cvector_size(vec); ++cv_free_i__) {                       \
+                    cv_free_elem_dtor__(&(vec)[cv_free_i__]);                                                 \
+                }                                                                                             \
+            }                                                                                                 \
+            if (cvector_owns_storage(vec)) {                                                                  \
+                cvector_alloc_free(cv_free_alloc__, cv_free_p__, cv_free_sz__);                               \
+            }                                                                                                 \
+        }                                                                                                     \
     } while (0)
 
 /**
@@ -242,30 +644,105 @@ typedef struct cvector_metadata_t {
 #define cvector_end(vec) \
     ((vec) ? &((vec)[cvector_size(vec)]) : NULL)
 
-/* user request to use linear growth algorithm */
-#ifdef CVECTOR_LINEAR_GROWTH
+/* once a vector holds this many bytes, CVECTOR_HYBRID_GROWTH stops doubling */
+#ifndef CVECTOR_HYBRID_GROWTH_THRESHOLD
+#define CVECTOR_HYBRID_GROWTH_THRESHOLD ((size_t)64 << 20)
+#endif
+
+/* beyond the threshold, CVECTOR_HYBRID_GROWTH grows by this many bytes (a multiple of the page size) */
+#ifndef CVECTOR_HYBRID_GROWTH_CHUNK
+#define CVECTOR_HYBRID_GROWTH_CHUNK ((size_t)64 << 20)
+#endif
 
 /**
- * @brief cvector_compute_next_grow - returns an the computed size in next vector grow
- * size is increased by 1
- * @param size - current size
- * @return size after next vector grow
+ * @brief cvector_growth_linear - growth policy, size is increased by 1
+ * @param size - current capacity
+ * @return capacity after the next grow
  */
-#define cvector_compute_next_grow(size) \
+#define cvector_growth_linear(size) \
     ((size) + 1)
 
+/**
+ * @brief cvector_growth_double - growth policy, size is increased by multiplication of 2
+ * @param size - current capacity
+ * @return capacity after the next grow
+ */
+#define cvector_growth_double(size) \
+    ((size) ? ((size) << 1) : 1)
+
+/**
+ * @brief cvector_growth_1_5 - growth policy, size is increased by multiplication of 1.5.
+ * Unlike doubling, the sum of all previously freed blocks eventually exceeds the next
+ * request, which lets the allocator reuse them.
+ * @param size - current capacity
+ * @return capacity after the next grow
+ */
+#define cvector_growth_1_5(size) \
+    ((size) > 1 ? (size) + ((size) >> 1) : (size) + 1)
+
+/**
+ * @brief cvector_growth_hybrid - growth policy, size is doubled until the vector holds
+ * CVECTOR_HYBRID_GROWTH_THRESHOLD bytes, after that it grows by CVECTOR_HYBRID_GROWTH_CHUNK bytes
+ * @param size - current capacity
+ * @param elem_size - size of an element in bytes
+ * @return capacity after the next grow
+ */
+#define cvector_growth_hybrid(size, elem_size)                         \
+    (((size) * (elem_size) < CVECTOR_HYBRID_GROWTH_THRESHOLD)          \
+         ? cvector_growth_double(size)                                 \
+         : (size) + ((CVECTOR_HYBRID_GROWTH_CHUNK / (elem_size))       \
+                         ? (CVECTOR_HYBRID_GROWTH_CHUNK / (elem_size)) \
+                         : 1))
+
+/* NOTE: the growth policy is chosen per translation unit. Defining
+ * CVECTOR_GROWTH_POLICY(size, elem_size) before including this header plugs
+ * in a custom policy, otherwise one of the following selects a built in one:
+ *
+ * CVECTOR_LINEAR_GROWTH     - grow by one element, minimizes unused space but
+ *                             makes filling a vector O(n^2)
+ * CVECTOR_GROWTH_FACTOR_1_5 - grow by 1.5x
+ * CVECTOR_HYBRID_GROWTH     - double up to CVECTOR_HYBRID_GROWTH_THRESHOLD
+ *                             bytes, then grow in CVECTOR_HYBRID_GROWTH_CHUNK
+ *                             byte steps
+ *
+ * and the default is to double. Independently of the policy, push_back and
+ * insert round the new capacity up to fill the block the allocator really
+ * hands out (see good_size_fn in cvector_allocator_t).
+ */
+#ifndef CVECTOR_GROWTH_POLICY
+#if defined(CVECTOR_LINEAR_GROWTH)
+#define CVECTOR_GROWTH_POLICY(size, elem_size) cvector_growth_linear(size)
+#elif defined(CVECTOR_GROWTH_FACTOR_1_5)
+#define CVECTOR_GROWTH_POLICY(size, elem_size) cvector_growth_1_5(size)
+#elif defined(CVECTOR_HYBRID_GROWTH)
+#define CVECTOR_GROWTH_POLICY(size, elem_size) cvector_growth_hybrid((size), (elem_size))
 #else
+#define CVECTOR_GROWTH_POLICY(size, elem_size) cvector_growth_double(size)
+#endif
+#endif /* CVECTOR_GROWTH_POLICY */
 
 /**
  * @brief cvector_compute_next_grow - returns an the computed size in next vector grow
- * size is increased by multiplication of 2
+ * using the growth policy of this translation unit, assuming elements of one byte
  * @param size - current size
  * @return size after next vector grow
  */
 #define cvector_compute_next_grow(size) \
-    ((size) ? ((size) << 1) : 1)
+    CVECTOR_GROWTH_POLICY((size), (size_t)1)
 
-#endif /* CVECTOR_LINEAR_GROWTH */
+/**
+ * @brief cvector_next_capacity - For internal use, the capacity a full vector grows to. Applies the growth
+ * policy and then rounds up so that the vector fills the whole block its allocator provides. This may be
+ * no more than `size` if the allocator can not provide a bigger block, callers grow to at least the count
+ * they need so that cvector_grow then fails.
+ * @param vec - the vector
+ * @param size - current capacity
+ * @return capacity after next vector grow
+ * @internal
+ */
+#define cvector_next_capacity(vec, size)                                                                                  \
+    ((cvector_good_size(cvector_allocator(vec), cvector_block_size((vec), CVECTOR_GROWTH_POLICY((size), sizeof(*(vec))))) \
+      - cvector_block_size((vec), 0)) / sizeof(*(vec)))
 
 /**
  * @brief cvector_push_back - adds an element to the end of the vector
@@ -273,14 +750,11 @@ typedef struct cvector_metadata_t {
  * @param value - the value to add
  * @return void
  */
-#define cvector_push_back(vec, value)                                           \
-    do {                                                                        \
-        size_t cv_push_back_cap__ = cvector_capacity(vec);                      \
-        if (cv_push_back_cap__ <= cvector_size(vec)) {                          \
-            cvector_grow((vec), cvector_compute_next_grow(cv_push_back_cap__)); \
-        }                                                                       \
-        (vec)[cvector_size(vec)] = (value);                                     \
-        cvector_set_size((vec), cvector_size(vec) + 1);                         \
+#define cvector_push_back(vec, value)                      \
+    do {                                                   \
+        cvector_grow_to_fit((vec), cvector_size(vec) + 1); \
+        (vec)[cvector_size(vec)] = (value);                \
+        cvector_set_size((vec), cvector_size(vec) + 1);    \
     } while (0)
 
 /**
@@ -290,22 +764,122 @@ typedef struct cvector_metadata_t {
  * @param val - value to be copied (or moved) to the inserted elements.
  * @return void
  */
-#define cvector_insert(vec, pos, val)                                        \
-    do {                                                                     \
-        size_t cv_insert_cap__ = cvector_capacity(vec);                      \
-        if (cv_insert_cap__ <= cvector_size(vec)) {                          \
-            cvector_grow((vec), cvector_compute_next_grow(cv_insert_cap__)); \
-        }                                                                    \
-        if ((pos) < cvector_size(vec)) {                                     \
-            cvector_clib_memmove(                                            \
-                (vec) + (pos) + 1,                                           \
-                (vec) + (pos),                                               \
-                sizeof(*(vec)) * ((cvector_size(vec)) - (pos)));             \
-        }                                                                    \
-        (vec)[(pos)] = (val);                                                \
-        cvector_set_size((vec), cvector_size(vec) + 1);                      \
+#define cvector_insert(vec, pos, val)                            \
+    do {                                                         \
+        cvector_grow_to_fit((vec), cvector_size(vec) + 1);       \
+        if ((pos) < cvector_size(vec)) {                         \
+            cvector_clib_memmove(                                \
+                (vec) + (pos) + 1,                               \
+                (vec) + (pos),                                   \
+                sizeof(*(vec)) * ((cvector_size(vec)) - (pos))); \
+        }                                                        \
+        (vec)[(pos)] = (val);                                    \
+        cvector_set_size((vec), cvector_size(vec) + 1);          \
+    } while (0)
+
+/**
+ * @brief cvector_emplace_back - adds an uninitialized element to the end of the vector and stores a pointer to it
+ * in `slot`, so that the element can be built in place instead of being copied in. The element already counts
+ * towards the size of the vector, so it must be initialized before the vector is used again.
+ * ex: struct record *r; cvector_emplace_back(v, r); r->id = 42;
+ * @param vec - the vector
+ * @param slot - an lvalue of type pointer to element which receives the address of the new element
+ * @return void
+ */
+#define cvector_emplace_back(vec, slot)                        \
+    do {                                                       \
+        const size_t cv_emplace_back_sz__ = cvector_size(vec); \
+        cvector_grow_to_fit((vec), cv_emplace_back_sz__ + 1);  \
+        cvector_set_size((vec), cv_emplace_back_sz__ + 1);     \
+        (slot) = &(vec)[cv_emplace_back_sz__];                 \
+    } while (0)
+
+/**
+ * @brief cvector_emplace - inserts an uninitialized element into the vector before `pos` and stores a pointer to it
+ * in `slot`, see cvector_emplace_back
+ * @param vec - the vector
+ * @param pos - index at which the element is inserted
+ * @param slot - an lvalue of type pointer to element which receives the address of the new element
+ * @return void
+ */
+#define cvector_emplace(vec, pos, slot)                 \
+    do {                                                \
+        const size_t cv_emplace_pos__ = (size_t)(pos);  \
+        cvector_insert_gap((vec), cv_emplace_pos__, 1); \
+        (slot) = &(vec)[cv_emplace_pos__];              \
+    } while (0)
+
+/**
+ * @brief cvector_insert_n - inserts `count` copies of `val` into the vector before `pos`.
+ * The vector grows at most once and the tail is shifted with a single memmove.
+ * @param vec - the vector
+ * @param pos - index at which the elements are inserted
+ * @param count - the number of elements to insert
+ * @param val - value to be copied to the inserted elements, evaluated once per element
+ * @return void
+ */
+#define cvector_insert_n(vec, pos, count, val)                                                    \
+    do {                                                                                          \
+        const size_t cv_insert_n_pos__   = (size_t)(pos);                                         \
+        const size_t cv_insert_n_count__ = (size_t)(count);                                       \
+        if (cv_insert_n_count__ > 0) {                                                            \
+            size_t cv_insert_n_i__;                                                               \
+            cvector_insert_gap((vec), cv_insert_n_pos__, cv_insert_n_count__);                    \
+            for (cv_insert_n_i__ = 0; cv_insert_n_i__ < cv_insert_n_count__; ++cv_insert_n_i__) { \
+                (vec)[cv_insert_n_pos__ + cv_insert_n_i__] = (val);                               \
+            }                                                                                     \
+        }                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_insert_range - inserts the elements of the range [first, last) into the vector before `pos`.
+ * The vector grows at most once, the tail is shifted with a single memmove and the elements are copied with a single memcpy.
+ * @param vec - the vector
+ * @param pos - index at which the elements are inserted
+ * @param first - pointer to the first element to copy, must not point into the vector itself
+ * @param last - pointer to one past the last element to copy
+ * @return void
+ */
+#define cvector_insert_range(vec, pos, first, last)                                                                \
+    do {                                                                                                           \
+        const size_t cv_insert_range_pos__   = (size_t)(pos);                                                      \
+        const size_t cv_insert_range_count__ = (size_t)((last) - (first));                                         \
+        if (cv_insert_range_count__ > 0) {                                                                         \
+            cvector_insert_gap((vec), cv_insert_range_pos__, cv_insert_range_count__);                             \
+            cvector_clib_memcpy((vec) + cv_insert_range_pos__, (first), cv_insert_range_count__ * sizeof(*(vec))); \
+        }                                                                                                          \
+    } while (0)
+
+/**
+ * @brief cvector_append_n - adds `n` elements copied from the array `src` to the end of the vector.
+ * The vector grows at most once and the elements are copied with a single memcpy.
+ * @param vec - the vector
+ * @param src - pointer to the first element to copy, must not point into the vector itself
+ * @param n - the number of elements to copy
+ * @return void
+ */
+#define cvector_append_n(vec, src, n)                                                                   \
+    do {                                                                                                \
+        const size_t cv_append_n_count__ = (size_t)(n);                                                 \
+        if (cv_append_n_count__ > 0) {                                                                  \
+            const size_t cv_append_n_sz__ = cvector_size(vec);                                          \
+            cvector_grow_to_fit((vec), cv_append_n_sz__ + cv_append_n_count__);                         \
+            cvector_clib_memcpy((vec) + cv_append_n_sz__, (src), cv_append_n_count__ * sizeof(*(vec))); \
+            cvector_set_size((vec), cv_append_n_sz__ + cv_append_n_count__);                            \
+        }                                                                                               \
     } while (0)
 
+/**
+ * @brief cvector_push_back_range - adds the elements of the range [first, last) to the end of the vector,
+ * see cvector_append_n. To append another vector `other`, pass cvector_begin(other) and cvector_end(other).
+ * @param vec - the vector
+ * @param first - pointer to the first element to copy
+ * @param last - pointer to one past the last element to copy
+ * @return void
+ */
+#define cvector_push_back_range(vec, first, last) \
+    cvector_append_n((vec), (first), (size_t)((last) - (first)))
+
 /**
  * @brief cvector_pop_back - removes the last element from the vector
  * @param vec - the vector
@@ -351,6 +925,84 @@ typedef struct cvector_metadata_t {
         }                                                    \
     } while (0)
 
+/**
+ * @brief cvector_move - transfers the contents of `src` to `dst` without copying. The previous contents
+ * of `dst` are freed (running the element destructor) and `src` is left NULL.
+ * @param dst - the destination vector
+ * @param src - the source vector, of the same type
+ * @return void
+ */
+#define cvector_move(dst, src) \
+    do {                       \
+        if ((dst) != (src)) {  \
+            cvector_free(dst); \
+            (dst) = (src);     \
+            (src) = NULL;      \
+        }                      \
+    } while (0)
+
+/**
+ * @brief CVECTOR_HEADER_SIZE - the number of bytes a block passed to cvector_adopt needs in front of the elements
+ */
+#define CVECTOR_HEADER_SIZE sizeof(cvector_metadata_t)
+
+/**
+ * @brief cvector_release - detaches the elements from the vector without running the element destructor, and
+ * leaves the vector NULL, so read cvector_size(vec) first. A vector which allocates through the cvector_clib_*
+ * functions hands over its own block without copying: `data` points at the elements inside `block`, which the
+ * caller releases with cvector_clib_free. A vector with its own allocator or in caller provided storage cannot
+ * hand over its block, so its elements ARE copied into a new array from cvector_clib_malloc, and `data` and
+ * `block` both point at that array.
+ * @param vec - the vector
+ * @param data - an lvalue of type pointer to element which receives the elements, or NULL if the vector is NULL
+ * @param block - an lvalue of type void * which receives the pointer to pass to cvector_clib_free, or NULL
+ * @return void
+ */
+#define cvector_release(vec, data, block)                                                                                                \
+    do {                                                                                                                                 \
+        if (!(vec)) {                                                                                                                    \
+            (data)  = NULL;                                                                                                              \
+            (block) = NULL;                                                                                                              \
+        } else if (cvector_owns_storage(vec) && !cvector_allocator(vec)) {                                                               \
+            (block) = cvector_vec_to_block(vec);                                                                                         \
+            (data)  = (vec);                                                                                                             \
+            (vec)   = NULL;                                                                                                              \
+        } else {                                                                                                                         \
+            const size_t cv_release_bytes__ = cvector_size(vec) * sizeof(*(vec));                                                        \
+            void *cv_release_p__            = cvector_clib_malloc(cv_release_bytes__ ? cv_release_bytes__ : 1);                          \
+            cvector_clib_assert(cv_release_p__);                                                                                         \
+            cvector_clib_memcpy(cv_release_p__, (vec), cv_release_bytes__);                                                              \
+            if (cvector_owns_storage(vec)) {                                                                                             \
+                cvector_alloc_free(cvector_allocator(vec), cvector_vec_to_block(vec), cvector_block_size((vec), cvector_capacity(vec))); \
+            }                                                                                                                            \
+            (block) = cv_release_p__;                                                                                                    \
+            (data)  = cv_release_p__;                                                                                                    \
+            (vec)   = NULL;                                                                                                              \
+        }                                                                                                                                \
+    } while (0)
+
+/**
+ * @brief cvector_adopt - turns a block allocated with cvector_clib_malloc into a vector without copying. The block
+ * must hold CVECTOR_HEADER_SIZE bytes, which become the metadata, followed by `count` elements. A block released by
+ * a vector created without cvector_init_aligned has this layout, as does one the caller allocated like this:
+ * ex: block = malloc(CVECTOR_HEADER_SIZE + n * sizeof(int)); fill((int *)((char *)block + CVECTOR_HEADER_SIZE), n);
+ * The vector takes ownership of the block. The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param block - the block
+ * @param count - the number of elements in the block, which is also the capacity of the vector
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_adopt(vec, block, count, elem_destructor_fn)                                                             \
+    do {                                                                                                                 \
+        if (!(vec)) {                                                                                                    \
+            const size_t cv_adopt_count__ = (size_t)(count);                                                             \
+            cvector_clib_assert(block);                                                                                  \
+            (vec) = cvector_base_to_vec(block);                                                                          \
+            cvector_set_metadata(cvector_vec_to_base(vec), cv_adopt_count__, cv_adopt_count__, (elem_destructor_fn), 0); \
+        }                                                                                                                \
+    } while (0)
+
 /**
  * @brief cvector_set_capacity - For internal use, sets the capacity variable of the vector
  * @param vec - the vector
@@ -393,6 +1045,127 @@ typedef struct cvector_metadata_t {
         }                                                                     \
     } while (0)
 
+/**
+ * @brief cvector_block_size - For internal use, the number of bytes of the block holding a vector of `count` elements
+ * @param vec - the vector
+ * @param count - the capacity of the vector
+ * @return the size of the block as a size_t
+ * @internal
+ */
+#define cvector_block_size(vec, count) \
+    cvector_block_bytes((count) * sizeof(*(vec)), cvector_block_prefix((vec) && (cvector_layout_flags(vec) & CVECTOR_FLAG_ALLOCATOR)), cvector_alignment(vec))
+
+/**
+ * @brief cvector_block_bytes - For internal use, the number of bytes of a block holding `bytes` bytes of elements
+ * @param bytes - the size of the elements in bytes
+ * @param prefix - the size of the prefix, see cvector_block_prefix
+ * @param align - the alignment of the elements
+ * @return the size of the block as a size_t
+ * @internal
+ */
+#define cvector_block_bytes(bytes, prefix, align) \
+    ((bytes) + sizeof(cvector_metadata_t) + (prefix) + (align) - 1)
+
+/**
+ * @brief cvector_align_offset - For internal use, the padding needed in front of the metadata so that the
+ * elements of a vector stored in the block at `ptr` are aligned to `align` bytes
+ * @param ptr - the start of the block
+ * @param align - the alignment of the elements, a power of two
+ * @return the padding in bytes as a size_t, less than `align`
+ * @internal
+ */
+#define cvector_align_offset(ptr, align) \
+    (((size_t)0 - ((size_t)(char *)(ptr) + sizeof(cvector_metadata_t))) & ((size_t)(align) - 1))
+
+/**
+ * @brief cvector_alloc_malloc - For internal use, allocates a block through `alloc`
+ * @param alloc - the allocator, NULL selects cvector_clib_malloc
+ * @param size - size of the block in bytes
+ * @return a pointer to the block, or NULL
+ * @internal
+ */
+#define cvector_alloc_malloc(alloc, size) \
+    ((alloc) ? (alloc)->malloc_fn((alloc)->ctx, (size)) : cvector_clib_malloc(size))
+
+/**
+ * @brief cvector_good_size - For internal use, the number of bytes `alloc` provides for a request of `size` bytes
+ * @param alloc - the allocator, NULL selects cvector_clib_good_size
+ * @param size - requested size in bytes
+ * @return the usable size of such a block, at least `size`
+ * @internal
+ */
+#define cvector_good_size(alloc, size) \
+    ((alloc) ? ((alloc)->good_size_fn ? (alloc)->good_size_fn((alloc)->ctx, (size)) : (size)) : cvector_clib_good_size(size))
+
+/**
+ * @brief cvector_alloc_realloc - For internal use, resizes a block through `alloc`
+ * @param alloc - the allocator, NULL selects cvector_clib_realloc
+ * @param ptr - the block
+ * @param old_size - current size of the block in bytes
+ * @param new_size - requested size of the block in bytes
+ * @return a pointer to the resized block, or NULL
+ * @internal
+ */
+#define cvector_alloc_realloc(alloc, ptr, old_size, new_size) \
+    ((alloc) ? (alloc)->realloc_fn((alloc)->ctx, (ptr), (old_size), (new_size)) : cvector_clib_realloc((ptr), (new_size)))
+
+/**
+ * @brief cvector_alloc_free - For internal use, releases a block through `alloc`
+ * @param alloc - the allocator, NULL selects cvector_clib_free
+ * @param ptr - the block
+ * @param size - size of the block in bytes
+ * @return void
+ * @internal
+ */
+#define cvector_alloc_free(alloc, ptr, size)               \
+    do {                                                   \
+        if (alloc) {                                       \
+            (alloc)->free_fn((alloc)->ctx, (ptr), (size)); \
+        } else {                                           \
+            cvector_clib_free(ptr);                        \
+        }                                                  \
+    } while (0)
+
+/**
+ * @brief cvector_allocate - For internal use, allocates a new empty vector with room for `count` elements
+ * @param vec - the vector, which must be NULL
+ * @param count - the capacity of the new vector
+ * @param align - the alignment of the elements, a power of two, 1 for none
+ * @param alloc - the allocator to use, NULL selects the cvector_clib_* functions
+ * @return void
+ * @internal
+ */
+#define cvector_allocate(vec, count, align, alloc)                                                                                                                                                                \
+    do {                                                                                                                                                                                                          \
+        const cvector_allocator_t *cv_allocate_alloc__ = (alloc);                                                                                                                                                 \
+        const size_t cv_allocate_count__               = (count);                                                                                                                                                 \
+        const size_t cv_allocate_align__               = (size_t)(align);                                                                                                                                         \
+        const size_t cv_allocate_prefix__              = cvector_block_prefix(cv_allocate_alloc__);                                                                                                               \
+        char *cv_allocate_p__                          = (char *)cvector_alloc_malloc(cv_allocate_alloc__, cvector_block_bytes(cv_allocate_count__ * sizeof(*(vec)), cv_allocate_prefix__, cv_allocate_align__)); \
+        size_t cv_allocate_off__;                                                                                                                                                                                 \
+        size_t cv_allocate_shift__;                                                                                                                                                                               \
+        cvector_clib_assert(cv_allocate_p__);                                                                                                                                                                     \
+        cv_allocate_off__ = cv_allocate_prefix__ + cvector_align_offset(cv_allocate_p__ + cv_allocate_prefix__, cv_allocate_align__);                                                                             \
+        cvector_align_shift(cv_allocate_align__, cv_allocate_shift__);                                                                                                                                            \
+        if (cv_allocate_alloc__) {                                                                                                                                                                                \
+            *(const cvector_allocator_t **)(void *)cv_allocate_p__ = cv_allocate_alloc__;                                                                                                                         \
+        }                                                                                                                                                                                                         \
+        (vec) = cvector_base_to_vec(cv_allocate_p__ + cv_allocate_off__);                                                                                                                                         \
+        cvector_set_metadata(cvector_vec_to_base(vec), 0, cv_allocate_count__, NULL,                                                                                                                              \
+                             cvector_make_layout(cv_allocate_alloc__ ? CVECTOR_FLAG_ALLOCATOR : 0, cv_allocate_shift__, cv_allocate_off__));                                                                      \
+    } while (0)
+
+/**
+ * @brief cvector_set_layout_offset - For internal use, records that the metadata moved to `offset` bytes from the start of its block
+ * @param vec - the vector
+ * @param flags - the new CVECTOR_FLAG_* flags
+ * @param offset - the new offset
+ * @return void
+ * @internal
+ */
+#define cvector_set_layout_offset(vec, flags, offset) \
+    (cvector_vec_to_base(vec)->layout = cvector_make_layout((flags), cvector_layout_shift(vec), (offset)))
+
 /**
  * @brief cvector_grow - For internal use, ensures that the vector is at least `count` elements big
  * @param vec - the vector
@@ -400,22 +1173,113 @@ typedef struct cvector_metadata_t {
  * @return void
  * @internal
  */
-#define cvector_grow(vec, count)                                                           \
-    do {                                                                                   \
-        const size_t cv_grow_sz__ = (count) * sizeof(*(vec)) + sizeof(cvector_metadata_t); \
-        if (vec) {                                                                         \
-            void *cv_grow_p1__ = cvector_vec_to_base(vec);                                 \
-            void *cv_grow_p2__ = cvector_clib_realloc(cv_grow_p1__, cv_grow_sz__);         \
-            cvector_clib_assert(cv_grow_p2__);                                             \
-            (vec) = cvector_base_to_vec(cv_grow_p2__);                                     \
-        } else {                                                                           \
-            void *cv_grow_p__ = cvector_clib_malloc(cv_grow_sz__);                         \
-            cvector_clib_assert(cv_grow_p__);                                              \
-            (vec) = cvector_base_to_vec(cv_grow_p__);                                      \
-            cvector_set_size((vec), 0);                                                    \
-            cvector_set_elem_destructor((vec), NULL);                                      \
-        }                                                                                  \
-        cvector_set_capacity((vec), (count));                                              \
+#define cvector_grow(vec, count)                                                                                                                             \
+    do {                                                                                                                                                     \
+        /* NOTE: `count` may depend on `vec`, so evaluate it before `vec` changes */                                                                         \
+        const size_t cv_grow_count__ = (count);                                                                                                              \
+        if (!(vec)) {                                                                                                                                        \
+            cvector_allocate((vec), cv_grow_count__, 1, NULL);                                                                                               \
+        } else if (!cvector_owns_storage(vec)) {                                                                                                             \
+            /* caller provided storage can only be left behind, never resized */                                                                             \
+            if (cv_grow_count__ > cvector_capacity(vec)) {                                                                                                   \
+                const cvector_allocator_t *cv_grow_alloc__ = cvector_allocator(vec);                                                                         \
+                const size_t cv_grow_prefix__              = cvector_block_prefix(cv_grow_alloc__);                                                          \
+                char *cv_grow_p__                          = (char *)cvector_alloc_malloc(cv_grow_alloc__, cvector_block_size((vec), cv_grow_count__));      \
+                size_t cv_grow_off__;                                                                                                                        \
+                cvector_clib_assert(cv_grow_p__);                                                                                                            \
+                cv_grow_off__ = cv_grow_prefix__ + cvector_align_offset(cv_grow_p__ + cv_grow_prefix__, cvector_alignment(vec));                             \
+                if (cv_grow_alloc__) {                                                                                                                       \
+                    *(const cvector_allocator_t **)(void *)cv_grow_p__ = cv_grow_alloc__;                                                                    \
+                }                                                                                                                                            \
+                cvector_clib_memcpy(cv_grow_p__ + cv_grow_off__, cvector_vec_to_base(vec), sizeof(cvector_metadata_t) + cvector_size(vec) * sizeof(*(vec))); \
+                (vec) = cvector_base_to_vec(cv_grow_p__ + cv_grow_off__);                                                                                    \
+                cvector_set_capacity((vec), cv_grow_count__);                                                                                                \
+                cvector_set_layout_offset((vec), cvector_layout_flags(vec) & ~CVECTOR_FLAG_NOT_OWNED, cv_grow_off__);                                        \
+            }                                                                                                                                                \
+        } else {                                                                                                                                             \
+            const cvector_allocator_t *cv_grow_alloc__ = cvector_allocator(vec);                                                                             \
+            const size_t cv_grow_prefix__              = cvector_block_prefix(cv_grow_alloc__);                                                              \
+            const size_t cv_grow_off1__                = cvector_layout_offset(vec);                                                                         \
+            const size_t cv_grow_align__               = cvector_alignment(vec);                                                                             \
+            const size_t cv_grow_used__                = sizeof(cvector_metadata_t) + cvector_size(vec) * sizeof(*(vec));                                    \
+            char *cv_grow_p__                          = (char *)cvector_alloc_realloc(                                                                      \
+                cv_grow_alloc__,                                                                                                                             \
+                cvector_vec_to_block(vec),                                                                                                                   \
+                cvector_block_size((vec), cvector_capacity(vec)),                                                                                            \
+                cvector_block_size((vec), cv_grow_count__));                                                                                                 \
+            size_t cv_grow_off2__;                                                                                                                           \
+            cvector_clib_assert(cv_grow_p__);                                                                                                                \
+            cv_grow_off2__ = cv_grow_prefix__ + cvector_align_offset(cv_grow_p__ + cv_grow_prefix__, cv_grow_align__);                                       \
+            if (cv_grow_off2__ != cv_grow_off1__) {                                                                                                          \
+                /* the block moved to an address with a different misalignment */                                                                            \
+                cvector_clib_memmove(cv_grow_p__ + cv_grow_off2__, cv_grow_p__ + cv_grow_off1__, cv_grow_used__);                                            \
+            }                                                                                                                                                \
+            (vec) = cvector_base_to_vec(cv_grow_p__ + cv_grow_off2__);                                                                                       \
+            cvector_set_capacity((vec), cv_grow_count__);                                                                                                    \
+            cvector_set_layout_offset((vec), cvector_layout_flags(vec), cv_grow_off2__);                                                                     \
+        }                                                                                                                                                    \
+    } while (0)
+
+/**
+ * @brief cvector_grow_to_fit - For internal use, ensures that the vector has room for `count` elements.
+ * Unlike cvector_reserve, the capacity grows at least as much as the growth policy would, so that
+ * repeated calls with slowly increasing counts stay amortized O(1) per element.
+ * @param vec - the vector
+ * @param count - the number of elements the vector must be able to hold
+ * @return void
+ * @internal
+ */
+#define cvector_grow_to_fit(vec, count)                                                                                           \
+    do {                                                                                                                          \
+        const size_t cv_grow_to_fit_count__ = (count);                                                                            \
+        const size_t cv_grow_to_fit_cap__   = cvector_capacity(vec);                                                              \
+        if (cv_grow_to_fit_cap__ < cv_grow_to_fit_count__) {                                                                      \
+            const size_t cv_grow_to_fit_next__ = cvector_next_capacity((vec), cv_grow_to_fit_cap__);                              \
+            cvector_grow((vec), cv_grow_to_fit_next__ > cv_grow_to_fit_count__ ? cv_grow_to_fit_next__ : cv_grow_to_fit_count__); \
+        }                                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_insert_gap - For internal use, makes room for `count` uninitialized elements before `pos`
+ * by growing the vector at most once and shifting the tail with a single memmove
+ * @param vec - the vector
+ * @param pos - index of the first element of the gap, at most cvector_size(vec)
+ * @param count - the number of elements in the gap
+ * @return void
+ * @internal
+ */
+#define cvector_insert_gap(vec, pos, count)                                     \
+    do {                                                                        \
+        const size_t cv_insert_gap_pos__   = (pos);                             \
+        const size_t cv_insert_gap_count__ = (count);                           \
+        const size_t cv_insert_gap_sz__    = cvector_size(vec);                 \
+        cvector_grow_to_fit((vec), cv_insert_gap_sz__ + cv_insert_gap_count__); \
+        if (cv_insert_gap_pos__ < cv_insert_gap_sz__) {                         \
+            cvector_clib_memmove(                                               \
+                (vec) + cv_insert_gap_pos__ + cv_insert_gap_count__,            \
+                (vec) + cv_insert_gap_pos__,                                    \
+                sizeof(*(vec)) * (cv_insert_gap_sz__ - cv_insert_gap_pos__));   \
+        }                                                                       \
+        cvector_set_size((vec), cv_insert_gap_sz__ + cv_insert_gap_count__);    \
+    } while (0)
+
+/**
+ * @brief cvector_destroy_range - For internal use, runs the element destructor, if any, over the elements with indices in [first, last)
+ * @param vec - the vector
+ * @param first - index of the first element
+ * @param last - index one past the last element
+ * @return void
+ * @internal
+ */
+#define cvector_destroy_range(vec, first, last)                                                           \
+    do {                                                                                                  \
+        cvector_elem_destructor_t cv_destroy_range_elem_dtor__ = cvector_elem_destructor(vec);            \
+        if (cv_destroy_range_elem_dtor__) {                                                               \
+            size_t cv_destroy_range_i__;                                                                  \
+            for (cv_destroy_range_i__ = (first); cv_destroy_range_i__ < (last); ++cv_destroy_range_i__) { \
+                cv_destroy_range_elem_dtor__(&(vec)[cv_destroy_range_i__]);                               \
+            }                                                                                             \
+        }                                                                                                 \
     } while (0)
 
 /**
@@ -463,21 +1327,69 @@ typedef struct cvector_metadata_t {
  * @param value - the value to initialize new elements with
  * @return void
  */
-#define cvector_resize(vec, count, value)                  \
-    do {                                                   \
-        size_t cv_resize_count__ = (size_t)(count);        \
-        size_t cv_resize_sz__    = cvector_size(vec);      \
-        if (cv_resize_count__ > cv_resize_sz__) {          \
-            cvector_reserve((vec), cv_resize_count__);     \
-            cvector_set_size((vec), cv_resize_count__);    \
-            do {                                           \
-                (vec)[cv_resize_sz__++] = (value);         \
-            } while (cv_resize_sz__ < cv_resize_count__);  \
-        } else {                                           \
-            while (cv_resize_count__ < cv_resize_sz__--) { \
-                cvector_pop_back(vec);                     \
-            }                                              \
-        }                                                  \
+#define cvector_resize(vec, count, value)                 \
+    do {                                                  \
+        size_t cv_resize_count__ = (size_t)(count);       \
+        size_t cv_resize_sz__    = cvector_size(vec);     \
+        if (cv_resize_count__ > cv_resize_sz__) {         \
+            cvector_reserve((vec), cv_resize_count__);    \
+            cvector_set_size((vec), cv_resize_count__);   \
+            do {                                          \
+                (vec)[cv_resize_sz__++] = (value);        \
+            } while (cv_resize_sz__ < cv_resize_count__); \
+        } else {                                          \
+            cvector_truncate((vec), cv_resize_count__);   \
+        }                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_resize_uninit - resizes the container to contain count elements, without initializing new elements.
+ * The new elements already count towards the size of the vector, so they must be written before they are read or destroyed.
+ * @param vec - the vector
+ * @param count - new size of the vector
+ * @return void
+ */
+#define cvector_resize_uninit(vec, count)                        \
+    do {                                                         \
+        const size_t cv_resize_uninit_count__ = (size_t)(count); \
+        if (cv_resize_uninit_count__ > cvector_size(vec)) {      \
+            cvector_reserve((vec), cv_resize_uninit_count__);    \
+            cvector_set_size((vec), cv_resize_uninit_count__);   \
+        } else {                                                 \
+            cvector_truncate((vec), cv_resize_uninit_count__);   \
+        }                                                        \
+    } while (0)
+
+/**
+ * @brief cvector_resize_zero - resizes the container to contain count elements, setting all bytes of new elements to zero.
+ * When an empty vector using the cvector_clib_* functions needs a larger block, the block is obtained from
+ * cvector_clib_calloc, which for large vectors can hand out pages that the kernel zeroes lazily.
+ * @param vec - the vector
+ * @param count - new size of the vector
+ * @return void
+ */
+#define cvector_resize_zero(vec, count)                                                                                                            \
+    do {                                                                                                                                           \
+        const size_t cv_resize_zero_count__ = (size_t)(count);                                                                                     \
+        const size_t cv_resize_zero_sz__    = cvector_size(vec);                                                                                   \
+        if (cv_resize_zero_count__ > cv_resize_zero_sz__) {                                                                                        \
+            if (cv_resize_zero_sz__ == 0 && cvector_capacity(vec) < cv_resize_zero_count__ && (!(vec) || cvector_vec_to_base(vec)->layout == 0)) { \
+                /* there is nothing to preserve, so replace the block instead of growing and clearing it */                                        \
+                cvector_elem_destructor_t cv_resize_zero_elem_dtor__ = cvector_elem_destructor(vec);                                               \
+                void *cv_resize_zero_p__;                                                                                                          \
+                cvector_free(vec);                                                                                                                 \
+                cv_resize_zero_p__ = cvector_clib_calloc(1, cv_resize_zero_count__ * sizeof(*(vec)) + sizeof(cvector_metadata_t));                 \
+                cvector_clib_assert(cv_resize_zero_p__);                                                                                           \
+                (vec) = cvector_base_to_vec(cv_resize_zero_p__);                                                                                   \
+                cvector_set_metadata(cvector_vec_to_base(vec), 0, cv_resize_zero_count__, cv_resize_zero_elem_dtor__, 0);                          \
+            } else {                                                                                                                               \
+                cvector_reserve((vec), cv_resize_zero_count__);                                                                                    \
+                cvector_clib_memset((vec) + cv_resize_zero_sz__, 0, (cv_resize_zero_count__ - cv_resize_zero_sz__) * sizeof(*(vec)));              \
+            }                                                                                                                                      \
+            cvector_set_size((vec), cv_resize_zero_count__);                                                                                       \
+        } else {                                                                                                                                   \
+            cvector_truncate((vec), cv_resize_zero_count__);                                                                                       \
+        }                                                                                                                                          \
     } while (0)
 
 #endif /* CVECTOR_H_ */
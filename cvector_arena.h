@@ -0,0 +1,218 @@
+#ifndef CVECTOR_ARENA_H_
+#define CVECTOR_ARENA_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief region (bump) allocator for request scoped vectors
+ * @file cvector_arena.h
+ */
+
+/* An arena hands out memory by bumping a pointer through large blocks which it
+ * obtains from cvector_clib_malloc. Vectors created in an arena never call the
+ * C library allocator themselves:
+ *
+ *  - growing the most recently allocated vector extends it in place.
+ *  - growing any other vector copies it to the end of the arena.
+ *  - cvector_free only gives memory back if the vector was the most recent
+ *    allocation, otherwise it is a no-op.
+ *
+ * cvector_arena_reset and cvector_arena_destroy release every vector of the
+ * arena at once. Element destructors are NOT called in that case, and every
+ * vector allocated from the arena is left dangling, so only use this for
+ * vectors which do not own resources (or call cvector_free on them first).
+ *
+ * This header contains declarations only, in exactly one translation unit
+ * define CVECTOR_ARENA_IMPLEMENTATION before including it:
+ *
+ * #define CVECTOR_ARENA_IMPLEMENTATION
+ * #include "cvector_arena.h"
+ *
+ * ex:
+ *
+ * cvector_arena_t arena;
+ * cvector_vector_type(int) v = NULL;
+ * cvector_arena_init(&arena, 0);
+ * cvector_init_in_arena(v, 16, NULL, &arena);
+ * cvector_push_back(v, 42);
+ * cvector_arena_destroy(&arena);
+ */
+#include "cvector.h"
+
+/* allocations are aligned to this many bytes, must be a power of two */
+#ifndef CVECTOR_ARENA_ALIGNMENT
+#define CVECTOR_ARENA_ALIGNMENT 16
+#endif
+
+/* block size used when cvector_arena_init is given a size of zero */
+#ifndef CVECTOR_ARENA_DEFAULT_BLOCK_SIZE
+#define CVECTOR_ARENA_DEFAULT_BLOCK_SIZE 65536
+#endif
+
+typedef struct cvector_arena_block_t cvector_arena_block_t;
+
+/* NOTE: vectors refer to `allocator`, which refers back to the arena, so an
+ * arena must not be moved or copied once it has been initialized. */
+typedef struct cvector_arena_t {
+    cvector_allocator_t allocator; /* the allocator which vectors of this arena refer to */
+    cvector_arena_block_t *blocks; /* the block allocations are taken from, linked to the older ones */
+    void *last;                    /* the most recent allocation, the only one which can grow in place */
+    size_t block_size;
+} cvector_arena_t;
+
+/**
+ * @brief cvector_arena_init - prepares an arena, no memory is allocated until it is first used
+ * @param arena - the arena
+ * @param block_size - minimum number of bytes to request from the C library at once, 0 selects CVECTOR_ARENA_DEFAULT_BLOCK_SIZE
+ * @return void
+ */
+void cvector_arena_init(cvector_arena_t *arena, size_t block_size);
+
+/**
+ * @brief cvector_arena_reset - releases every allocation of the arena, keeping one block around for reuse
+ * @param arena - the arena
+ * @return void
+ */
+void cvector_arena_reset(cvector_arena_t *arena);
+
+/**
+ * @brief cvector_arena_destroy - releases every allocation and all memory held by the arena
+ * @param arena - the arena
+ * @return void
+ */
+void cvector_arena_destroy(cvector_arena_t *arena);
+
+/**
+ * @brief cvector_arena_alloc - allocates `size` bytes from the arena
+ * @param arena - the arena
+ * @param size - number of bytes
+ * @return a pointer aligned to CVECTOR_ARENA_ALIGNMENT, or NULL if out of memory
+ */
+void *cvector_arena_alloc(cvector_arena_t *arena, size_t size);
+
+/**
+ * @brief cvector_init_in_arena - Initialize a vector whose storage lives in `arena`.
+ * The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @param arena - pointer to the cvector_arena_t
+ * @return void
+ */
+#define cvector_init_in_arena(vec, capacity, elem_destructor_fn, arena) \
+    cvector_init_with_allocator((vec), (capacity), (elem_destructor_fn), &(arena)->allocator)
+
+#ifdef CVECTOR_ARENA_IMPLEMENTATION
+
+struct cvector_arena_block_t {
+    cvector_arena_block_t *next;
+    size_t capacity;
+    size_t used;
+};
+
+#define cvector_arena_round_up(n) \
+    (((n) + (CVECTOR_ARENA_ALIGNMENT - 1)) & ~(size_t)(CVECTOR_ARENA_ALIGNMENT - 1))
+
+#define cvector_arena_block_data(block) \
+    ((char *)(block) + cvector_arena_round_up(sizeof(cvector_arena_block_t)))
+
+static void *cvector_arena_malloc_fn(void *ctx, size_t size) {
+    return cvector_arena_alloc((cvector_arena_t *)ctx, size);
+}
+
+static void *cvector_arena_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    cvector_arena_t *arena       = (cvector_arena_t *)ctx;
+    cvector_arena_block_t *block = arena->blocks;
+    void *p;
+
+    if (ptr == arena->last) {
+        /* the most recent allocation simply moves the end of the block */
+        const size_t offset = (size_t)((char *)ptr - cvector_arena_block_data(block));
+        if (new_size <= block->capacity - offset) {
+            block->used = offset + cvector_arena_round_up(new_size);
+            return ptr;
+        }
+    } else if (new_size <= old_size) {
+        return ptr;
+    }
+
+    p = cvector_arena_alloc(arena, new_size);
+    if (p) {
+        cvector_clib_memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return p;
+}
+
+static void cvector_arena_free_fn(void *ctx, void *ptr, size_t size) {
+    cvector_arena_t *arena = (cvector_arena_t *)ctx;
+    (void)size;
+
+    /* only the most recent allocation can be handed back */
+    if (ptr == arena->last) {
+        arena->blocks->used = (size_t)((char *)ptr - cvector_arena_block_data(arena->blocks));
+        arena->last         = NULL;
+    }
+}
+
+void cvector_arena_init(cvector_arena_t *arena, size_t block_size) {
+    arena->allocator.malloc_fn    = cvector_arena_malloc_fn;
+    arena->allocator.realloc_fn   = cvector_arena_realloc_fn;
+    arena->allocator.free_fn      = cvector_arena_free_fn;
+    arena->allocator.ctx          = arena;
+    arena->allocator.good_size_fn = NULL;
+    arena->blocks                 = NULL;
+    arena->last                   = NULL;
+    arena->block_size             = block_size ? block_size : CVECTOR_ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void *cvector_arena_alloc(cvector_arena_t *arena, size_t size) {
+    cvector_arena_block_t *block = arena->blocks;
+    const size_t rounded         = cvector_arena_round_up(size);
+    void *p;
+
+    if (!block || block->capacity - block->used < rounded) {
+        const size_t capacity = rounded > arena->block_size ? rounded : arena->block_size;
+        block                 = (cvector_arena_block_t *)cvector_clib_malloc(cvector_arena_round_up(sizeof(cvector_arena_block_t)) + capacity);
+        if (!block) {
+            return NULL;
+        }
+        block->next     = arena->blocks;
+        block->capacity = capacity;
+        block->used     = 0;
+        arena->blocks   = block;
+    }
+
+    p            = cvector_arena_block_data(block) + block->used;
+    block->used += rounded;
+    arena->last  = p;
+    return p;
+}
+
+void cvector_arena_reset(cvector_arena_t *arena) {
+    cvector_arena_block_t *block = arena->blocks;
+    if (block) {
+        cvector_arena_block_t *next = block->next;
+        while (next) {
+            cvector_arena_block_t *p = next;
+            next                     = next->next;
+            cvector_clib_free(p);
+        }
+        block->next = NULL;
+        block->used = 0;
+    }
+    arena->last = NULL;
+}
+
+void cvector_arena_destroy(cvector_arena_t *arena) {
+    cvector_arena_block_t *block = arena->blocks;
+    while (block) {
+        cvector_arena_block_t *next = block->next;
+        cvector_clib_free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+    arena->last   = NULL;
+}
+
+#endif /* CVECTOR_ARENA_IMPLEMENTATION */
+
+#endif /* CVECTOR_ARENA_H_ */
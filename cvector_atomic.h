@@ -0,0 +1,57 @@
+#ifndef CVECTOR_ATOMIC_H_
+#define CVECTOR_ATOMIC_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief the few atomic operations the concurrent containers need
+ * @file cvector_atomic.h
+ */
+
+/* C11 atomics are used when the compiler provides them, otherwise the GCC
+ * (and clang) __atomic builtins, which have the same semantics and also work
+ * in C89/C90 mode. Only size_t counters, pointers and an acquire fence are
+ * needed, so that is all this provides. The pointer operations take a pointer to an ordinary
+ * (non-_Atomic) pointer object, which has the same representation as an
+ * atomic one on every platform these builtins exist on. */
+#include <stddef.h>
+
+/* the size of a cache line, used to pad indices which different threads write */
+#ifndef CVECTOR_CACHE_LINE
+#define CVECTOR_CACHE_LINE 64
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+
+typedef atomic_size_t cvector_atomic_size_t;
+
+#define cvector_atomic_init(p, v)          atomic_init((p), (v))
+#define cvector_atomic_load_relaxed(p)     atomic_load_explicit((p), memory_order_relaxed)
+#define cvector_atomic_load_acquire(p)     atomic_load_explicit((p), memory_order_acquire)
+#define cvector_atomic_store_release(p, v) atomic_store_explicit((p), (v), memory_order_release)
+#define cvector_atomic_fetch_add(p, v)     atomic_fetch_add_explicit((p), (v), memory_order_acq_rel)
+#define cvector_atomic_fence_acquire()     atomic_thread_fence(memory_order_acquire)
+
+#define cvector_atomic_load_ptr_acquire(p) \
+    atomic_load_explicit((_Atomic(void *) *)(void *)(p), memory_order_acquire)
+#define cvector_atomic_cas_ptr(p, expected, desired) \
+    atomic_compare_exchange_strong_explicit((_Atomic(void *) *)(void *)(p), (expected), (desired), memory_order_acq_rel, memory_order_acquire)
+#elif defined(__GNUC__)
+typedef size_t cvector_atomic_size_t;
+
+#define cvector_atomic_init(p, v)          (*(p) = (v))
+#define cvector_atomic_load_relaxed(p)     __atomic_load_n((p), __ATOMIC_RELAXED)
+#define cvector_atomic_load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define cvector_atomic_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define cvector_atomic_fetch_add(p, v)     __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define cvector_atomic_fence_acquire()     __atomic_thread_fence(__ATOMIC_ACQUIRE)
+
+#define cvector_atomic_load_ptr_acquire(p) \
+    __atomic_load_n((void **)(void *)(p), __ATOMIC_ACQUIRE)
+#define cvector_atomic_cas_ptr(p, expected, desired) \
+    __atomic_compare_exchange_n((void **)(void *)(p), (expected), (desired), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+#error "cvector_atomic.h needs C11 atomics or the __atomic builtins"
+#endif
+
+#endif /* CVECTOR_ATOMIC_H_ */
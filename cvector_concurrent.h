@@ -0,0 +1,283 @@
+#ifndef CVECTOR_CONCURRENT_H_
+#define CVECTOR_CONCURRENT_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief vectors which many threads can append to without a lock
+ * @file cvector_concurrent.h
+ */
+
+/* A concurrent vector is appended to by any number of threads at once. Each
+ * cvector_concurrent_push_back reserves a slot with an atomic fetch-add on the
+ * number of reserved slots and then writes the element without any lock.
+ *
+ * Since the elements of a growing vector cannot be moved while other threads
+ * write to them, the storage is a fixed directory of CVECTOR_CONCURRENT_SEGMENTS
+ * segments, where segment k holds CVECTOR_CONCURRENT_FIRST_SEGMENT << k
+ * elements. The first thread which reserves a slot in a segment that does not
+ * exist yet allocates it and installs it with a compare-and-swap. If several
+ * threads race, the losers free their allocation and use the winner's, so
+ * nobody ever waits for another thread. Slot i lives in segment
+ * k = log2(i / CVECTOR_CONCURRENT_FIRST_SEGMENT + 1).
+ *
+ * The vector is a pointer to the directory, `v[k]` is segment k. Reading the
+ * elements (cvector_concurrent_at, cvector_concurrent_copy, ...) is only
+ * meaningful once the appending threads are done and the reader has called
+ * cvector_concurrent_seal: from then on cvector_concurrent_size is the number
+ * of elements and all of them are written.
+ *
+ * cvector_concurrent_type(struct result) results = NULL;
+ * cvector_concurrent_init(results, NULL);               (before the threads start)
+ * cvector_concurrent_push_back(results, r);             (from any thread)
+ * n = cvector_concurrent_seal(results);                 (after joining them)
+ * cvector_concurrent_copy(results, flat);
+ * cvector_concurrent_free(results);
+ */
+#include "cvector.h"
+#include "cvector_atomic.h"
+
+/* number of elements in the first segment, a power of two */
+#ifndef CVECTOR_CONCURRENT_FIRST_SEGMENT
+#define CVECTOR_CONCURRENT_FIRST_SEGMENT 1024
+#endif
+
+/* number of segments, the vector holds up to FIRST_SEGMENT * (2^SEGMENTS - 1) elements */
+#ifndef CVECTOR_CONCURRENT_SEGMENTS
+#define CVECTOR_CONCURRENT_SEGMENTS 32
+#endif
+
+typedef struct cvector_concurrent_metadata_t {
+    /* slots handed out by cvector_concurrent_push_back, the only counter they
+     * contend on; the elements are all written once the threads are joined */
+    cvector_atomic_size_t reserved;
+    char pad0[CVECTOR_CACHE_LINE - sizeof(cvector_atomic_size_t)];
+
+    /* constant after cvector_concurrent_init */
+    cvector_elem_destructor_t elem_destructor;
+    size_t offset;
+    char pad1[CVECTOR_CACHE_LINE - sizeof(cvector_elem_destructor_t) - sizeof(size_t)];
+} cvector_concurrent_metadata_t;
+
+/**
+ * @brief cvector_concurrent_type - The concurrent vector type used in this library
+ * @param type The type of concurrent vector to act on.
+ */
+#define cvector_concurrent_type(type) cvector_vector_type(type *)
+
+/**
+ * @brief cvector_concurrent_vec_to_meta - For internal use, converts a concurrent vector to a metadata pointer
+ * @param v - the concurrent vector
+ * @return the metadata pointer
+ * @internal
+ */
+#define cvector_concurrent_vec_to_meta(v) \
+    (&((cvector_concurrent_metadata_t *)(void *)(v))[-1])
+
+/**
+ * @brief cvector_concurrent_log2 - For internal use, the index of the highest set bit of a non-zero value
+ * @param x - the value
+ * @return the index as a size_t
+ * @internal
+ */
+#if defined(__GNUC__)
+#define cvector_concurrent_log2(x) \
+    ((size_t)(sizeof(unsigned long long) * 8 - 1) - (size_t)__builtin_clzll((unsigned long long)(x)))
+#else
+/* counts the set positions above bit 0 in each 32 bit half, so no shift reaches the width of size_t */
+#define cvector_concurrent_log2(x)                                                               \
+    ((size_t)((size_t)(x) >> 16 >> 16 ? 32 + cvector_concurrent_log2_32((size_t)(x) >> 16 >> 16) \
+                                      : cvector_concurrent_log2_32((size_t)(x))))
+#define cvector_concurrent_log2_32(x)                                                                                  \
+    (((x) >> 1 != 0) + ((x) >> 2 != 0) + ((x) >> 3 != 0) + ((x) >> 4 != 0) + ((x) >> 5 != 0) + ((x) >> 6 != 0) +       \
+     ((x) >> 7 != 0) + ((x) >> 8 != 0) + ((x) >> 9 != 0) + ((x) >> 10 != 0) + ((x) >> 11 != 0) + ((x) >> 12 != 0) +    \
+     ((x) >> 13 != 0) + ((x) >> 14 != 0) + ((x) >> 15 != 0) + ((x) >> 16 != 0) + ((x) >> 17 != 0) + ((x) >> 18 != 0) + \
+     ((x) >> 19 != 0) + ((x) >> 20 != 0) + ((x) >> 21 != 0) + ((x) >> 22 != 0) + ((x) >> 23 != 0) + ((x) >> 24 != 0) + \
+     ((x) >> 25 != 0) + ((x) >> 26 != 0) + ((x) >> 27 != 0) + ((x) >> 28 != 0) + ((x) >> 29 != 0) + ((x) >> 30 != 0) + \
+     ((x) >> 31 != 0))
+#endif
+
+/**
+ * @brief cvector_concurrent_segment - For internal use, the segment holding slot `i`
+ * @param i - the slot
+ * @return the segment as a size_t
+ * @internal
+ */
+#define cvector_concurrent_segment(i) \
+    cvector_concurrent_log2((size_t)(i) / CVECTOR_CONCURRENT_FIRST_SEGMENT + 1)
+
+/**
+ * @brief cvector_concurrent_segment_length - For internal use, the number of elements in segment `k`
+ * @param k - the segment
+ * @return the number of elements as a size_t
+ * @internal
+ */
+#define cvector_concurrent_segment_length(k) \
+    ((size_t)CVECTOR_CONCURRENT_FIRST_SEGMENT << (k))
+
+/**
+ * @brief cvector_concurrent_segment_offset - For internal use, the position of slot `i` inside segment `k`
+ * @param i - the slot
+ * @param k - the segment holding it
+ * @return the position as a size_t
+ * @internal
+ */
+#define cvector_concurrent_segment_offset(i, k) \
+    ((size_t)(i) + CVECTOR_CONCURRENT_FIRST_SEGMENT - cvector_concurrent_segment_length(k))
+
+/**
+ * @brief cvector_concurrent_segment_ptr - For internal use, `seg` as a pointer to the elements of `v`
+ * @param v - the concurrent vector
+ * @param seg - a segment of `v` as a void pointer
+ * @param k - the segment
+ * @return the segment with the type of `v[k]`
+ * @internal
+ */
+#if defined(__GNUC__)
+#define cvector_concurrent_segment_ptr(v, seg, k) \
+    ((__typeof__(*(v)))(seg))
+#else
+/* without typeof the segment can only be typed by reading it from the directory again,
+ * which happens after its installation, so the read does not race */
+#define cvector_concurrent_segment_ptr(v, seg, k) \
+    ((void)(seg), (v)[k])
+#endif
+
+/**
+ * @brief cvector_concurrent_init - Initialize a concurrent vector, before it is shared between threads. The vector must be NULL for this to do anything.
+ * @param v - the concurrent vector
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_concurrent_init(v, elem_destructor_fn)                                                                                                          \
+    do {                                                                                                                                                        \
+        if (!(v)) {                                                                                                                                             \
+            const size_t cv_concurrent_init_sz__ = sizeof(cvector_concurrent_metadata_t) + CVECTOR_CONCURRENT_SEGMENTS * sizeof(*(v)) + CVECTOR_CACHE_LINE - 1; \
+            char *cv_concurrent_init_p__         = (char *)cvector_clib_malloc(cv_concurrent_init_sz__);                                                        \
+            size_t cv_concurrent_init_off__;                                                                                                                    \
+            cvector_concurrent_metadata_t *cv_concurrent_init_m__;                                                                                              \
+            size_t cv_concurrent_init_k__;                                                                                                                      \
+            cvector_clib_assert(cv_concurrent_init_p__);                                                                                                        \
+            cv_concurrent_init_off__ = ((size_t)0 - (size_t)cv_concurrent_init_p__) & (CVECTOR_CACHE_LINE - 1);                                                 \
+            cv_concurrent_init_m__   = (cvector_concurrent_metadata_t *)(void *)(cv_concurrent_init_p__ + cv_concurrent_init_off__);                            \
+            cvector_atomic_init(&cv_concurrent_init_m__->reserved, 0);                                                                                          \
+            cv_concurrent_init_m__->elem_destructor = (elem_destructor_fn);                                                                                     \
+            cv_concurrent_init_m__->offset          = cv_concurrent_init_off__;                                                                                 \
+            (v)                                     = (void *)(cv_concurrent_init_m__ + 1);                                                                     \
+            for (cv_concurrent_init_k__ = 0; cv_concurrent_init_k__ < CVECTOR_CONCURRENT_SEGMENTS; ++cv_concurrent_init_k__) {                                  \
+                (v)[cv_concurrent_init_k__] = NULL;                                                                                                             \
+            }                                                                                                                                                   \
+        }                                                                                                                                                       \
+    } while (0)
+
+/**
+ * @brief cvector_concurrent_push_back - adds an element to the end of the concurrent vector, safe to call from many threads at once
+ * @param v - the concurrent vector
+ * @param value - the value to add
+ * @return void
+ */
+#define cvector_concurrent_push_back(v, value)                                                                                                                       \
+    do {                                                                                                                                                             \
+        cvector_concurrent_metadata_t *cv_concurrent_push_back_m__ = cvector_concurrent_vec_to_meta(v);                                                              \
+        const size_t cv_concurrent_push_back_slot__                = cvector_atomic_fetch_add(&cv_concurrent_push_back_m__->reserved, 1);                            \
+        const size_t cv_concurrent_push_back_k__                   = cvector_concurrent_segment(cv_concurrent_push_back_slot__);                                     \
+        const size_t cv_concurrent_push_back_i__                   = cvector_concurrent_segment_offset(cv_concurrent_push_back_slot__, cv_concurrent_push_back_k__); \
+        void *cv_concurrent_push_back_seg__;                                                                                                                         \
+        cvector_clib_assert(cv_concurrent_push_back_k__ < CVECTOR_CONCURRENT_SEGMENTS);                                                                              \
+        cv_concurrent_push_back_seg__ = cvector_atomic_load_ptr_acquire(&(v)[cv_concurrent_push_back_k__]);                                                          \
+        if (!cv_concurrent_push_back_seg__) {                                                                                                                        \
+            /* first one here allocates the segment, everybody else who raced uses it */                                                                             \
+            void *cv_concurrent_push_back_new__ = cvector_clib_malloc(cvector_concurrent_segment_length(cv_concurrent_push_back_k__) * sizeof(**(v)));               \
+            cvector_clib_assert(cv_concurrent_push_back_new__);                                                                                                      \
+            if (cvector_atomic_cas_ptr(&(v)[cv_concurrent_push_back_k__], &cv_concurrent_push_back_seg__, cv_concurrent_push_back_new__)) {                          \
+                cv_concurrent_push_back_seg__ = cv_concurrent_push_back_new__;                                                                                       \
+            } else {                                                                                                                                                 \
+                cvector_clib_free(cv_concurrent_push_back_new__);                                                                                                    \
+            }                                                                                                                                                        \
+        }                                                                                                                                                            \
+        cvector_concurrent_segment_ptr((v), cv_concurrent_push_back_seg__, cv_concurrent_push_back_k__)[cv_concurrent_push_back_i__] = (value);                      \
+    } while (0)
+
+/**
+ * @brief cvector_concurrent_seal - publishes the elements to the calling thread once the appending threads are done,
+ * that is after joining them, or after a barrier, condition variable or release store which they reach once they have
+ * finished appending. The acquire fence also makes such a hand off through a relaxed load safe.
+ * @param v - the concurrent vector
+ * @return the number of elements, which all are written, as a size_t
+ */
+#define cvector_concurrent_seal(v) \
+    ((v) ? (cvector_atomic_fence_acquire(), cvector_atomic_load_relaxed(&cvector_concurrent_vec_to_meta(v)->reserved)) : (size_t)0)
+
+/**
+ * @brief cvector_concurrent_size - gets the number of elements which have been appended. This is only exact after
+ * cvector_concurrent_seal, while threads are still appending it counts slots whose element may still be in the middle
+ * of being written.
+ * @param v - the concurrent vector
+ * @return the size as a size_t
+ */
+#define cvector_concurrent_size(v) \
+    ((v) ? cvector_atomic_load_acquire(&cvector_concurrent_vec_to_meta(v)->reserved) : (size_t)0)
+
+/**
+ * @brief cvector_concurrent_empty - returns non-zero if the concurrent vector is empty
+ * @param v - the concurrent vector
+ * @return non-zero if empty, zero if non-empty
+ */
+#define cvector_concurrent_empty(v) \
+    (cvector_concurrent_size(v) == 0)
+
+/**
+ * @brief cvector_concurrent_at - returns a pointer to the element at position n, once the appending threads are done
+ * @param v - the concurrent vector
+ * @param n - the position of the element
+ * @return a pointer to the element, or NULL if n is out of range
+ */
+#define cvector_concurrent_at(v, n)                                                                                   \
+    ((size_t)(n) < cvector_concurrent_size(v)                                                                         \
+         ? &(v)[cvector_concurrent_segment(n)][cvector_concurrent_segment_offset((n), cvector_concurrent_segment(n))] \
+         : NULL)
+
+/**
+ * @brief cvector_concurrent_copy - appends the elements of a concurrent vector to a regular vector, once the appending threads are done
+ * @param from - the concurrent vector
+ * @param to - the vector, which grows at most once
+ * @return void
+ */
+#define cvector_concurrent_copy(from, to)                                                                                         \
+    do {                                                                                                                          \
+        size_t cv_concurrent_copy_left__ = cvector_concurrent_size(from);                                                         \
+        size_t cv_concurrent_copy_k__;                                                                                            \
+        cvector_reserve((to), cvector_size(to) + cv_concurrent_copy_left__);                                                      \
+        for (cv_concurrent_copy_k__ = 0; cv_concurrent_copy_left__ > 0; ++cv_concurrent_copy_k__) {                               \
+            size_t cv_concurrent_copy_n__ = cvector_concurrent_segment_length(cv_concurrent_copy_k__);                            \
+            if (cv_concurrent_copy_n__ > cv_concurrent_copy_left__) {                                                             \
+                cv_concurrent_copy_n__ = cv_concurrent_copy_left__;                                                               \
+            }                                                                                                                     \
+            cvector_clib_memcpy((to) + cvector_size(to), (from)[cv_concurrent_copy_k__], cv_concurrent_copy_n__ * sizeof(*(to))); \
+            cvector_set_size((to), cvector_size(to) + cv_concurrent_copy_n__);                                                    \
+            cv_concurrent_copy_left__ -= cv_concurrent_copy_n__;                                                                  \
+        }                                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_concurrent_free - frees all memory associated with the concurrent vector, once no thread uses it
+ * @param v - the concurrent vector
+ * @return void
+ */
+#define cvector_concurrent_free(v)                                                                                                \
+    do {                                                                                                                          \
+        if (v) {                                                                                                                  \
+            cvector_concurrent_metadata_t *cv_concurrent_free_m__ = cvector_concurrent_vec_to_meta(v);                            \
+            size_t cv_concurrent_free_i__;                                                                                        \
+            if (cv_concurrent_free_m__->elem_destructor) {                                                                        \
+                for (cv_concurrent_free_i__ = 0; cv_concurrent_free_i__ < cvector_concurrent_size(v); ++cv_concurrent_free_i__) { \
+                    cv_concurrent_free_m__->elem_destructor(cvector_concurrent_at((v), cv_concurrent_free_i__));                  \
+                }                                                                                                                 \
+            }                                                                                                                     \
+            for (cv_concurrent_free_i__ = 0; cv_concurrent_free_i__ < CVECTOR_CONCURRENT_SEGMENTS; ++cv_concurrent_free_i__) {    \
+                cvector_clib_free((v)[cv_concurrent_free_i__]);                                                                   \
+            }                                                                                                                     \
+            cvector_clib_free((char *)cv_concurrent_free_m__ - cv_concurrent_free_m__->offset);                                   \
+        }                                                                                                                         \
+    } while (0)
+
+#endif /* CVECTOR_CONCURRENT_H_ */
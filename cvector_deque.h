@@ -0,0 +1,308 @@
+#ifndef CVECTOR_DEQUE_H_
+#define CVECTOR_DEQUE_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief double-ended queues stored as ring buffers
+ * @file cvector_deque.h
+ */
+
+/* A deque is a ring buffer: the elements start at `head` and wrap around the
+ * end of the storage, so adding and removing at either end is O(1) instead of
+ * the O(n) memmove of cvector_erase(vec, 0). The ring position is kept in a
+ * cvector_deque_metadata_t which wraps the usual meta-data, so the layout is
+ * head, tail, the cvector_metadata_t and then the elements. This means
+ * cvector_size, cvector_capacity and cvector_empty work on a deque, but
+ * everything which adds, removes or indexes elements must go through the
+ * cvector_deque_* macros, since `d[i]` is not the i-th element once the ring
+ * wraps. The elements are the two contiguous segments
+ * cvector_deque_segment1(d) and cvector_deque_segment2(d):
+ *
+ * cvector_deque_type(int) q = NULL;
+ * int *it;
+ * cvector_deque_push_back(q, 1);
+ * cvector_deque_push_front(q, 0);
+ * for (it = cvector_deque_segment1(q); it != cvector_deque_segment1(q) + cvector_deque_segment1_size(q); ++it) { ... }
+ * for (it = cvector_deque_segment2(q); it != cvector_deque_segment2(q) + cvector_deque_segment2_size(q); ++it) { ... }
+ * cvector_deque_free(q);
+ */
+#include "cvector.h"
+
+typedef struct cvector_deque_metadata_t {
+    size_t head;
+    size_t tail;
+    cvector_metadata_t base;
+} cvector_deque_metadata_t;
+
+/**
+ * @brief cvector_deque_type - The deque type used in this library
+ * @param type The type of deque to act on.
+ */
+#define cvector_deque_type(type) cvector_vector_type(type)
+
+/**
+ * @brief cvector_deque_vec_to_meta - For internal use, converts a deque pointer to a deque metadata pointer
+ * @param d - the deque
+ * @return the deque metadata pointer
+ * @internal
+ */
+#define cvector_deque_vec_to_meta(d) \
+    (&((cvector_deque_metadata_t *)(void *)(d))[-1])
+
+/**
+ * @brief cvector_deque_wrap - For internal use, wraps a storage index which may be up to one capacity too large
+ * @param d - the deque
+ * @param i - the index
+ * @return the wrapped index as a size_t
+ * @internal
+ */
+#define cvector_deque_wrap(d, i) \
+    ((size_t)(i) >= cvector_capacity(d) ? (size_t)(i) - cvector_capacity(d) : (size_t)(i))
+
+/**
+ * @brief cvector_deque_segment1 - returns a pointer to the first of the two contiguous runs of elements
+ * @param d - the deque
+ * @return a pointer to the first element (or NULL)
+ */
+#define cvector_deque_segment1(d) \
+    ((d) ? &(d)[cvector_deque_vec_to_meta(d)->head] : NULL)
+
+/**
+ * @brief cvector_deque_segment1_size - gets the number of elements in the first run
+ * @param d - the deque
+ * @return the number of elements as a size_t
+ */
+#define cvector_deque_segment1_size(d)                                                 \
+    ((d) ? (cvector_size(d) < cvector_capacity(d) - cvector_deque_vec_to_meta(d)->head \
+                ? cvector_size(d)                                                      \
+                : cvector_capacity(d) - cvector_deque_vec_to_meta(d)->head)            \
+         : (size_t)0)
+
+/**
+ * @brief cvector_deque_segment2 - returns a pointer to the second run of elements, which continues the first one at the start of the storage
+ * @param d - the deque
+ * @return a pointer to the first element of the run (or NULL)
+ */
+#define cvector_deque_segment2(d) (d)
+
+/**
+ * @brief cvector_deque_segment2_size - gets the number of elements in the second run
+ * @param d - the deque
+ * @return the number of elements as a size_t
+ */
+#define cvector_deque_segment2_size(d) \
+    (cvector_size(d) - cvector_deque_segment1_size(d))
+
+/**
+ * @brief cvector_deque_grow - For internal use, moves the elements to new storage of `count` elements, unwrapping the ring
+ * @param d - the deque
+ * @param count - the new capacity to set
+ * @return void
+ * @internal
+ */
+#define cvector_deque_grow(d, count)                                                                                                                                            \
+    do {                                                                                                                                                                        \
+        const size_t cv_deque_grow_count__          = (count);                                                                                                                  \
+        cvector_deque_metadata_t *cv_deque_grow_m__ = (cvector_deque_metadata_t *)cvector_clib_malloc(sizeof(cvector_deque_metadata_t) + cv_deque_grow_count__ * sizeof(*(d))); \
+        cvector_clib_assert(cv_deque_grow_m__);                                                                                                                                 \
+        if (d) {                                                                                                                                                                \
+            cvector_deque_metadata_t *cv_deque_grow_old__ = cvector_deque_vec_to_meta(d);                                                                                       \
+            const size_t cv_deque_grow_first__            = cvector_deque_segment1_size(d);                                                                                     \
+            cvector_clib_memcpy(cv_deque_grow_m__ + 1, &(d)[cv_deque_grow_old__->head], cv_deque_grow_first__ * sizeof(*(d)));                                                  \
+            cvector_clib_memcpy((char *)(cv_deque_grow_m__ + 1) + cv_deque_grow_first__ * sizeof(*(d)), (d), cvector_deque_segment2_size(d) * sizeof(*(d)));                    \
+            cv_deque_grow_m__->base = cv_deque_grow_old__->base;                                                                                                                \
+            cvector_clib_free(cv_deque_grow_old__);                                                                                                                             \
+        } else {                                                                                                                                                                \
+            cvector_set_metadata(&cv_deque_grow_m__->base, 0, 0, NULL, cvector_make_layout(0, 0, sizeof(cvector_deque_metadata_t) - sizeof(cvector_metadata_t)));               \
+        }                                                                                                                                                                       \
+        cv_deque_grow_m__->base.capacity = cv_deque_grow_count__;                                                                                                               \
+        cv_deque_grow_m__->head          = 0;                                                                                                                                   \
+        cv_deque_grow_m__->tail          = cv_deque_grow_m__->base.size < cv_deque_grow_count__ ? cv_deque_grow_m__->base.size : 0;                                             \
+        (d)                              = (void *)(cv_deque_grow_m__ + 1);                                                                                                     \
+    } while (0)
+
+/**
+ * @brief cvector_deque_init - Initialize a deque. The deque must be NULL for this to do anything.
+ * @param d - the deque
+ * @param capacity - the initial capacity
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_deque_init(d, capacity, elem_destructor_fn)                 \
+    do {                                                                    \
+        if (!(d)) {                                                         \
+            cvector_deque_grow((d), (capacity));                            \
+            cvector_vec_to_base(d)->elem_destructor = (elem_destructor_fn); \
+        }                                                                   \
+    } while (0)
+
+/**
+ * @brief cvector_deque_reserve - Requests that the deque capacity be at least enough to contain n elements.
+ * @param d - the deque
+ * @param n - Minimum capacity for the deque.
+ * @return void
+ */
+#define cvector_deque_reserve(d, n)                          \
+    do {                                                     \
+        size_t cv_deque_reserve_cap__ = (size_t)(n);         \
+        if (cvector_capacity(d) < cv_deque_reserve_cap__) {  \
+            cvector_deque_grow((d), cv_deque_reserve_cap__); \
+        }                                                    \
+    } while (0)
+
+/**
+ * @brief cvector_deque_grow_if_full - For internal use, makes room for one more element
+ * @param d - the deque
+ * @return void
+ * @internal
+ */
+#define cvector_deque_grow_if_full(d)                                                                                                                             \
+    do {                                                                                                                                                          \
+        size_t cv_deque_grow_if_full_cap__ = cvector_capacity(d);                                                                                                 \
+        if (cv_deque_grow_if_full_cap__ <= cvector_size(d)) {                                                                                                     \
+            const size_t cv_deque_grow_if_full_next__ = cvector_next_capacity((d), cv_deque_grow_if_full_cap__);                                                  \
+            cvector_deque_grow((d), cv_deque_grow_if_full_next__ > cv_deque_grow_if_full_cap__ ? cv_deque_grow_if_full_next__ : cv_deque_grow_if_full_cap__ + 1); \
+        }                                                                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_deque_push_back - adds an element to the end of the deque
+ * @param d - the deque
+ * @param value - the value to add
+ * @return void
+ */
+#define cvector_deque_push_back(d, value)                                                                          \
+    do {                                                                                                           \
+        cvector_deque_grow_if_full(d);                                                                             \
+        (d)[cvector_deque_vec_to_meta(d)->tail] = (value);                                                         \
+        cvector_deque_vec_to_meta(d)->tail      = cvector_deque_wrap((d), cvector_deque_vec_to_meta(d)->tail + 1); \
+        cvector_set_size((d), cvector_size(d) + 1);                                                                \
+    } while (0)
+
+/**
+ * @brief cvector_deque_push_front - adds an element to the front of the deque
+ * @param d - the deque
+ * @param value - the value to add
+ * @return void
+ */
+#define cvector_deque_push_front(d, value)                                                                                          \
+    do {                                                                                                                            \
+        cvector_deque_grow_if_full(d);                                                                                              \
+        cvector_deque_vec_to_meta(d)->head = cvector_deque_wrap((d), cvector_deque_vec_to_meta(d)->head + cvector_capacity(d) - 1); \
+        (d)[cvector_deque_vec_to_meta(d)->head] = (value);                                                                          \
+        cvector_set_size((d), cvector_size(d) + 1);                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_deque_pop_front - removes the first element from the deque, if there is one
+ * @param d - the deque
+ * @return void
+ */
+#define cvector_deque_pop_front(d)                                                                                \
+    do {                                                                                                          \
+        if (!cvector_empty(d)) {                                                                                  \
+            cvector_elem_destructor_t cv_deque_pop_front_elem_dtor__ = cvector_elem_destructor(d);                \
+            if (cv_deque_pop_front_elem_dtor__) {                                                                 \
+                cv_deque_pop_front_elem_dtor__(&(d)[cvector_deque_vec_to_meta(d)->head]);                         \
+            }                                                                                                     \
+            cvector_deque_vec_to_meta(d)->head = cvector_deque_wrap((d), cvector_deque_vec_to_meta(d)->head + 1); \
+            cvector_set_size((d), cvector_size(d) - 1);                                                           \
+        }                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_deque_pop_back - removes the last element from the deque, if there is one
+ * @param d - the deque
+ * @return void
+ */
+#define cvector_deque_pop_back(d)                                                                                                       \
+    do {                                                                                                                                \
+        if (!cvector_empty(d)) {                                                                                                        \
+            cvector_elem_destructor_t cv_deque_pop_back_elem_dtor__ = cvector_elem_destructor(d);                                       \
+            cvector_deque_vec_to_meta(d)->tail = cvector_deque_wrap((d), cvector_deque_vec_to_meta(d)->tail + cvector_capacity(d) - 1); \
+            if (cv_deque_pop_back_elem_dtor__) {                                                                                        \
+                cv_deque_pop_back_elem_dtor__(&(d)[cvector_deque_vec_to_meta(d)->tail]);                                                \
+            }                                                                                                                           \
+            cvector_set_size((d), cvector_size(d) - 1);                                                                                 \
+        }                                                                                                                               \
+    } while (0)
+
+/**
+ * @brief cvector_deque_at - returns a pointer to the element at position n, counted from the front
+ * @param d - the deque
+ * @param n - the position of the element
+ * @return a pointer to the element, or NULL if n is out of range
+ */
+#define cvector_deque_at(d, n) \
+    ((size_t)(n) < cvector_size(d) ? &(d)[cvector_deque_wrap((d), cvector_deque_vec_to_meta(d)->head + (size_t)(n))] : NULL)
+
+/**
+ * @brief cvector_deque_front - returns a pointer to the first element
+ * @param d - the deque
+ * @return a pointer to the first element, or NULL if the deque is empty
+ */
+#define cvector_deque_front(d) \
+    cvector_deque_at((d), 0)
+
+/**
+ * @brief cvector_deque_back - returns a pointer to the last element
+ * @param d - the deque
+ * @return a pointer to the last element, or NULL if the deque is empty
+ */
+#define cvector_deque_back(d) \
+    (cvector_empty(d) ? NULL : cvector_deque_at((d), cvector_size(d) - 1))
+
+/**
+ * @brief cvector_deque_for_each - call function func on each element of the deque, front to back
+ * @param d - the deque
+ * @param func - function to be called on each element that takes each element as argument
+ * @return void
+ */
+#define cvector_deque_for_each(d, func)                                                                                        \
+    do {                                                                                                                       \
+        if ((d) && (func) != NULL) {                                                                                           \
+            size_t cv_deque_for_each_i__;                                                                                      \
+            for (cv_deque_for_each_i__ = 0; cv_deque_for_each_i__ < cvector_deque_segment1_size(d); ++cv_deque_for_each_i__) { \
+                func(cvector_deque_segment1(d)[cv_deque_for_each_i__]);                                                        \
+            }                                                                                                                  \
+            for (cv_deque_for_each_i__ = 0; cv_deque_for_each_i__ < cvector_deque_segment2_size(d); ++cv_deque_for_each_i__) { \
+                func(cvector_deque_segment2(d)[cv_deque_for_each_i__]);                                                        \
+            }                                                                                                                  \
+        }                                                                                                                      \
+    } while (0)
+
+/**
+ * @brief cvector_deque_clear - erases all of the elements in the deque
+ * @param d - the deque
+ * @return void
+ */
+#define cvector_deque_clear(d)                                                                             \
+    do {                                                                                                   \
+        if (d) {                                                                                           \
+            cvector_elem_destructor_t cv_deque_clear_elem_dtor__ = cvector_elem_destructor(d);             \
+            if (cv_deque_clear_elem_dtor__) {                                                              \
+                size_t cv_deque_clear_i__;                                                                 \
+                for (cv_deque_clear_i__ = 0; cv_deque_clear_i__ < cvector_size(d); ++cv_deque_clear_i__) { \
+                    cv_deque_clear_elem_dtor__(cvector_deque_at((d), cv_deque_clear_i__));                 \
+                }                                                                                          \
+            }                                                                                              \
+            cvector_deque_vec_to_meta(d)->head = 0;                                                        \
+            cvector_deque_vec_to_meta(d)->tail = 0;                                                        \
+            cvector_set_size((d), 0);                                                                      \
+        }                                                                                                  \
+    } while (0)
+
+/**
+ * @brief cvector_deque_free - frees all memory associated with the deque
+ * @param d - the deque
+ * @return void
+ */
+#define cvector_deque_free(d)                                \
+    do {                                                     \
+        if (d) {                                             \
+            cvector_deque_clear(d);                          \
+            cvector_clib_free(cvector_deque_vec_to_meta(d)); \
+        }                                                    \
+    } while (0)
+
+#endif /* CVECTOR_DEQUE_H_ */
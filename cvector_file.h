@@ -0,0 +1,535 @@
+#ifndef CVECTOR_FILE_H_
+#define CVECTOR_FILE_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief saving vectors to files and streams, and mapping files back without copying
+ * @file cvector_file.h
+ */
+
+/* File format, all header fields are unsigned 64 bit little endian integers:
+ *
+ *   offset  field
+ *   0       magic, the bytes "cvector" followed by a zero byte
+ *   8       version, CVECTOR_FILE_VERSION
+ *   16      flags, CVECTOR_FILE_BIG_ENDIAN if the elements were written by a big endian machine
+ *   24      elem_size, sizeof of one element
+ *   32      count, number of elements
+ *   40      data_offset, offset of the first element, a multiple of CVECTOR_FILE_ALIGNMENT when written by cvector_save
+ *   48      zero padding up to data_offset
+ *   data_offset  count * elem_size bytes of raw elements
+ *
+ * The elements are stored exactly as they are in memory, so a file can only
+ * be read back into a vector of the same element type on a machine with the
+ * same byte order and struct layout. cvector_map_file checks the element size
+ * and byte order, nothing more.
+ *
+ * cvector_map_file maps the elements of such a file directly into memory and
+ * returns a normal looking vector: every cvector_* function works on it and
+ * cvector_free unmaps it. Nothing is read until an element is touched, so
+ * even very large files open instantly. With CVECTOR_MAP_READONLY writing to
+ * an element crashes, with CVECTOR_MAP_PRIVATE writes are private to the
+ * process (copy-on-write) and never reach the file. The capacity of a mapped
+ * vector equals its size, so growing it copies it to anonymous memory first.
+ *
+ * Streams written by cvector_write_stream do not need to be seekable, so they
+ * can go through pipes and sockets. They start with a header of the same kind
+ * of fields followed by a checksum:
+ *
+ *   offset  field
+ *   0       magic, the bytes "cvstream"
+ *   8       version, CVECTOR_STREAM_VERSION
+ *   16      flags, as above
+ *   24      elem_size
+ *   32      count
+ *   40      chunk_size, CVECTOR_STREAM_CHUNK_SIZE when written by cvector_write_stream
+ *   48      Adler-32 of the 48 bytes before it, unsigned 32 bit little endian
+ *
+ * followed by count * elem_size bytes of raw elements cut into chunks of
+ * chunk_size bytes (the last one may be shorter), each chunk followed by its
+ * own Adler-32. The chunks are written straight from and read straight into
+ * the vector, and cvector_read_stream allocates the whole vector up front
+ * from the count in the header, so neither side ever holds a second copy.
+ *
+ * This header contains declarations only, in exactly one translation unit
+ * define CVECTOR_FILE_IMPLEMENTATION before including it:
+ *
+ * #define CVECTOR_FILE_IMPLEMENTATION
+ * #include "cvector_file.h"
+ *
+ * ex:
+ *
+ * cvector_vector_type(double) table = NULL;
+ * cvector_push_back(table, 1.0);
+ * if (cvector_save(table, "table.cvec") != 0) { ... }
+ * cvector_free(table);
+ *
+ * table = NULL;
+ * if (!cvector_map_file(table, "table.cvec", CVECTOR_MAP_READONLY)) { ... }
+ * cvector_free(table);
+ */
+#include "cvector.h"
+#include <stdio.h>
+
+#define CVECTOR_FILE_VERSION 1
+
+/* CVECTOR_FILE_BIG_ENDIAN is set in the flags of files written on big endian machines */
+#define CVECTOR_FILE_BIG_ENDIAN 0x1u
+
+/* size of the header fields, the elements start at the first multiple of CVECTOR_FILE_ALIGNMENT after it */
+#define CVECTOR_FILE_HEADER_SIZE 48
+
+/* alignment of the elements inside files written by cvector_save, a multiple
+ * of the page size of every machine which maps the file */
+#ifndef CVECTOR_FILE_ALIGNMENT
+#define CVECTOR_FILE_ALIGNMENT 65536
+#endif
+
+#define CVECTOR_STREAM_VERSION 1
+
+/* size of the stream header including its checksum */
+#define CVECTOR_STREAM_HEADER_SIZE 52
+
+/* bytes of elements between two checksums in streams written by cvector_write_stream */
+#ifndef CVECTOR_STREAM_CHUNK_SIZE
+#define CVECTOR_STREAM_CHUNK_SIZE 65536
+#endif
+
+/* modes of cvector_map_file */
+#define CVECTOR_MAP_READONLY 0
+#define CVECTOR_MAP_PRIVATE 1
+
+/**
+ * @brief cvector_file_save - writes `count` elements of `elem_size` bytes to a new file at `path`, see cvector_save
+ * @param data - the elements
+ * @param count - number of elements
+ * @param elem_size - size of an element in bytes
+ * @param path - the file, which is replaced if it exists
+ * @return 0 on success, -1 on failure with errno set
+ */
+int cvector_file_save(const void *data, size_t count, size_t elem_size, const char *path);
+
+/**
+ * @brief cvector_file_map - maps a file written by cvector_file_save, see cvector_map_file
+ * @param path - the file
+ * @param elem_size - the expected size of an element in bytes
+ * @param mode - CVECTOR_MAP_READONLY or CVECTOR_MAP_PRIVATE
+ * @return the vector, or NULL on failure with errno set
+ */
+void *cvector_file_map(const char *path, size_t elem_size, int mode);
+
+/**
+ * @brief cvector_file_write_stream - writes `count` elements of `elem_size` bytes to `file`, see cvector_write_stream
+ * @param data - the elements
+ * @param count - number of elements
+ * @param elem_size - size of an element in bytes
+ * @param file - the stream to write to
+ * @param fd - the file descriptor to write to, only used if `file` is NULL
+ * @return 0 on success, -1 on failure with errno set
+ */
+int cvector_file_write_stream(const void *data, size_t count, size_t elem_size, FILE *file, int fd);
+
+/**
+ * @brief cvector_file_read_stream - reads a vector written by cvector_file_write_stream, see cvector_read_stream
+ * @param elem_size - the expected size of an element in bytes
+ * @param file - the stream to read from
+ * @param fd - the file descriptor to read from, only used if `file` is NULL
+ * @return the vector, or NULL on failure with errno set
+ */
+void *cvector_file_read_stream(size_t elem_size, FILE *file, int fd);
+
+/**
+ * @brief cvector_save - writes the elements of the vector to a new file at `path`
+ * @param vec - the vector
+ * @param path - the file, which is replaced if it exists
+ * @return 0 on success, -1 on failure with errno set
+ */
+#define cvector_save(vec, path) \
+    cvector_file_save((vec), cvector_size(vec), sizeof(*(vec)), (path))
+
+/**
+ * @brief cvector_map_file - replaces `vec` with a vector whose elements are mapped from a file written by cvector_save.
+ * The previous value of `vec` is overwritten, not freed. Release the mapping with cvector_free.
+ * @param vec - the vector
+ * @param path - the file
+ * @param mode - CVECTOR_MAP_READONLY or CVECTOR_MAP_PRIVATE
+ * @return non-zero on success, zero on failure (with `vec` set to NULL)
+ */
+#define cvector_map_file(vec, path, mode) \
+    (((vec) = cvector_file_map((path), sizeof(*(vec)), (mode))) != NULL)
+
+/**
+ * @brief cvector_write_stream - writes the elements of the vector to `file` in checksummed chunks
+ * @param vec - the vector
+ * @param file - the stream, which is not flushed
+ * @return 0 on success, -1 on failure with errno set
+ */
+#define cvector_write_stream(vec, file) \
+    cvector_file_write_stream((vec), cvector_size(vec), sizeof(*(vec)), (file), -1)
+
+/**
+ * @brief cvector_write_fd - writes the elements of the vector to the file descriptor `fd` in checksummed chunks
+ * @param vec - the vector
+ * @param fd - the file descriptor
+ * @return 0 on success, -1 on failure with errno set
+ */
+#define cvector_write_fd(vec, fd) \
+    cvector_file_write_stream((vec), cvector_size(vec), sizeof(*(vec)), NULL, (fd))
+
+/**
+ * @brief cvector_read_stream - replaces `vec` with a new vector read from `file`, which was written by cvector_write_stream.
+ * The previous value of `vec` is overwritten, not freed.
+ * @param vec - the vector
+ * @param file - the stream
+ * @return non-zero on success, zero on failure (with `vec` set to NULL)
+ */
+#define cvector_read_stream(vec, file) \
+    (((vec) = cvector_file_read_stream(sizeof(*(vec)), (file), -1)) != NULL)
+
+/**
+ * @brief cvector_read_fd - replaces `vec` with a new vector read from the file descriptor `fd`, see cvector_read_stream
+ * @param vec - the vector
+ * @param fd - the file descriptor
+ * @return non-zero on success, zero on failure (with `vec` set to NULL)
+ */
+#define cvector_read_fd(vec, fd) \
+    (((vec) = cvector_file_read_stream(sizeof(*(vec)), NULL, (fd))) != NULL)
+
+#ifdef CVECTOR_FILE_IMPLEMENTATION
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+static const unsigned char cvector_file_magic[8]   = {'c', 'v', 'e', 'c', 't', 'o', 'r', 0};
+static const unsigned char cvector_stream_magic[8] = {'c', 'v', 's', 't', 'r', 'e', 'a', 'm'};
+
+static unsigned int cvector_file_native_flags(void) {
+    const unsigned int one = 1;
+    return *(const unsigned char *)&one ? 0 : CVECTOR_FILE_BIG_ENDIAN;
+}
+
+static void cvector_file_put(unsigned char *p, size_t value) {
+    int i;
+    for (i = 0; i < 8; ++i) {
+        p[i] = (unsigned char)(value & 0xff);
+        value >>= 8;
+    }
+}
+
+static int cvector_file_get(const unsigned char *p, size_t *value) {
+    int i;
+    size_t v = 0;
+    for (i = 7; i >= 0; --i) {
+        /* reject values which do not fit in a size_t */
+        if (v >> (sizeof(size_t) * 8 - 8)) {
+            return -1;
+        }
+        v = (v << 8) | p[i];
+    }
+    *value = v;
+    return 0;
+}
+
+static unsigned long cvector_file_adler32(const unsigned char *p, size_t n) {
+    unsigned long a = 1;
+    unsigned long b = 0;
+    while (n) {
+        /* 5552 bytes is the most that can be summed before b may overflow 32 bits */
+        size_t k = n < 5552 ? n : 5552;
+        n -= k;
+        while (k--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void cvector_file_put32(unsigned char *p, unsigned long value) {
+    p[0] = (unsigned char)(value & 0xff);
+    p[1] = (unsigned char)((value >> 8) & 0xff);
+    p[2] = (unsigned char)((value >> 16) & 0xff);
+    p[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+static unsigned long cvector_file_get32(const unsigned char *p) {
+    return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* writes all `size` bytes to `file`, or to `fd` if `file` is NULL */
+static int cvector_file_write_all(FILE *file, int fd, const void *data, size_t size) {
+    const char *p = (const char *)data;
+    if (file) {
+        return fwrite(p, 1, size, file) == size ? 0 : -1;
+    }
+    while (size) {
+        const ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/* reads exactly `size` bytes from `file`, or from `fd` if `file` is NULL */
+static int cvector_file_read_all(FILE *file, int fd, void *data, size_t size) {
+    char *p = (char *)data;
+    if (file) {
+        if (fread(p, 1, size, file) != size) {
+            if (!ferror(file)) {
+                errno = EINVAL;
+            }
+            return -1;
+        }
+        return 0;
+    }
+    while (size) {
+        const ssize_t n = read(fd, p, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            /* truncated stream */
+            errno = EINVAL;
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/* the vectors returned by cvector_file_map, the first page of the block holds
+ * the metadata and the file is mapped right behind it */
+static void *cvector_file_map_anonymous(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void *cvector_file_malloc_fn(void *ctx, size_t size) {
+    (void)ctx;
+    return cvector_file_map_anonymous(size);
+}
+
+static void *cvector_file_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    void *p = cvector_file_map_anonymous(new_size);
+    (void)ctx;
+    if (p) {
+        cvector_clib_memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        munmap(ptr, old_size);
+    }
+    return p;
+}
+
+static void cvector_file_free_fn(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    munmap(ptr, size);
+}
+
+static const cvector_allocator_t cvector_file_allocator = {
+    cvector_file_malloc_fn,
+    cvector_file_realloc_fn,
+    cvector_file_free_fn,
+    NULL,
+    NULL,
+};
+
+int cvector_file_save(const void *data, size_t count, size_t elem_size, const char *path) {
+    unsigned char header[CVECTOR_FILE_HEADER_SIZE];
+    FILE *file;
+    int ok;
+
+    if (elem_size && count > ((size_t)-1 - CVECTOR_FILE_ALIGNMENT) / elem_size) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    cvector_clib_memset(header, 0, sizeof(header));
+    cvector_clib_memcpy(header, cvector_file_magic, sizeof(cvector_file_magic));
+    cvector_file_put(header + 8, CVECTOR_FILE_VERSION);
+    cvector_file_put(header + 16, cvector_file_native_flags());
+    cvector_file_put(header + 24, elem_size);
+    cvector_file_put(header + 32, count);
+    cvector_file_put(header + 40, CVECTOR_FILE_ALIGNMENT);
+
+    file = fopen(path, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    /* the padding up to the elements is left as a hole */
+    ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    if (ok && count) {
+        ok = fseek(file, CVECTOR_FILE_ALIGNMENT, SEEK_SET) == 0 && fwrite(data, elem_size, count, file) == count;
+    }
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    return ok ? 0 : -1;
+}
+
+void *cvector_file_map(const char *path, size_t elem_size, int mode) {
+    const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    const int prot         = mode == CVECTOR_MAP_PRIVATE ? PROT_READ | PROT_WRITE : PROT_READ;
+    unsigned char header[CVECTOR_FILE_HEADER_SIZE];
+    size_t version, flags, file_elem_size, count, data_offset, bytes, block_size, shift;
+    struct stat st;
+    cvector_metadata_t *base;
+    char *block;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    /* validate the header */
+    if (read(fd, header, sizeof(header)) != (ssize_t)sizeof(header) || fstat(fd, &st) != 0 ||
+        memcmp(header, cvector_file_magic, sizeof(cvector_file_magic)) != 0 ||
+        cvector_file_get(header + 8, &version) != 0 || cvector_file_get(header + 16, &flags) != 0 ||
+        cvector_file_get(header + 24, &file_elem_size) != 0 || cvector_file_get(header + 32, &count) != 0 ||
+        cvector_file_get(header + 40, &data_offset) != 0 ||
+        version != CVECTOR_FILE_VERSION || flags != cvector_file_native_flags() || file_elem_size != elem_size ||
+        data_offset < CVECTOR_FILE_HEADER_SIZE || data_offset % page_size != 0 ||
+        (elem_size && count > ((size_t)-1 - page_size * 2) / elem_size) ||
+        (count && ((size_t)st.st_size < data_offset || (size_t)st.st_size - data_offset < count * elem_size))) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    bytes = count * elem_size;
+
+    /* one page for the allocator and the metadata followed by the elements.
+     * This is exactly the size cvector_block_size reports for the vector (see
+     * the alignment below), which is what cvector_free passes to
+     * cvector_file_free_fn */
+    block_size = cvector_block_bytes(bytes, sizeof(const cvector_allocator_t *), page_size);
+    block      = (char *)cvector_file_map_anonymous(block_size);
+    if (!block) {
+        close(fd);
+        return NULL;
+    }
+
+    if (bytes && mmap(block + page_size, bytes, prot, MAP_PRIVATE | MAP_FIXED, fd, (off_t)data_offset) == MAP_FAILED) {
+        const int error = errno;
+        munmap(block, block_size);
+        close(fd);
+        errno = error;
+        return NULL;
+    }
+    close(fd);
+
+    /* the elements are page aligned, and recording that as the alignment
+     * keeps the metadata page inside the padding cvector_grow accounts for */
+    cvector_align_shift(page_size, shift);
+    *(const cvector_allocator_t **)(void *)block = &cvector_file_allocator;
+    base                                         = (cvector_metadata_t *)(block + page_size) - 1;
+    cvector_set_metadata(base, count, count, NULL, cvector_make_layout(CVECTOR_FLAG_ALLOCATOR, shift, page_size - sizeof(cvector_metadata_t)));
+    return base + 1;
+}
+
+int cvector_file_write_stream(const void *data, size_t count, size_t elem_size, FILE *file, int fd) {
+    unsigned char header[CVECTOR_STREAM_HEADER_SIZE];
+    unsigned char checksum[4];
+    const unsigned char *p = (const unsigned char *)data;
+    size_t bytes;
+
+    if (elem_size && count > (size_t)-1 / elem_size) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    bytes = count * elem_size;
+
+    cvector_clib_memcpy(header, cvector_stream_magic, sizeof(cvector_stream_magic));
+    cvector_file_put(header + 8, CVECTOR_STREAM_VERSION);
+    cvector_file_put(header + 16, cvector_file_native_flags());
+    cvector_file_put(header + 24, elem_size);
+    cvector_file_put(header + 32, count);
+    cvector_file_put(header + 40, CVECTOR_STREAM_CHUNK_SIZE);
+    cvector_file_put32(header + 48, cvector_file_adler32(header, 48));
+    if (cvector_file_write_all(file, fd, header, sizeof(header)) != 0) {
+        return -1;
+    }
+
+    while (bytes) {
+        const size_t n = bytes < CVECTOR_STREAM_CHUNK_SIZE ? bytes : CVECTOR_STREAM_CHUNK_SIZE;
+        cvector_file_put32(checksum, cvector_file_adler32(p, n));
+        if (cvector_file_write_all(file, fd, p, n) != 0 || cvector_file_write_all(file, fd, checksum, sizeof(checksum)) != 0) {
+            return -1;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return 0;
+}
+
+void *cvector_file_read_stream(size_t elem_size, FILE *file, int fd) {
+    unsigned char header[CVECTOR_STREAM_HEADER_SIZE];
+    unsigned char checksum[4];
+    size_t version, flags, file_elem_size, count, chunk_size, bytes;
+    cvector_metadata_t *base;
+    unsigned char *p;
+
+    if (cvector_file_read_all(file, fd, header, sizeof(header)) != 0) {
+        return NULL;
+    }
+
+    /* validate the header */
+    if (memcmp(header, cvector_stream_magic, sizeof(cvector_stream_magic)) != 0 ||
+        cvector_file_get32(header + 48) != cvector_file_adler32(header, 48) ||
+        cvector_file_get(header + 8, &version) != 0 || cvector_file_get(header + 16, &flags) != 0 ||
+        cvector_file_get(header + 24, &file_elem_size) != 0 || cvector_file_get(header + 32, &count) != 0 ||
+        cvector_file_get(header + 40, &chunk_size) != 0 ||
+        version != CVECTOR_STREAM_VERSION || flags != cvector_file_native_flags() || file_elem_size != elem_size ||
+        chunk_size == 0 || (elem_size && count > ((size_t)-1 - sizeof(cvector_metadata_t)) / elem_size)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    bytes = count * elem_size;
+
+    /* the whole vector in one allocation, laid out like cvector_adopt does */
+    base = (cvector_metadata_t *)cvector_clib_malloc(sizeof(cvector_metadata_t) + bytes);
+    if (!base) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    cvector_set_metadata(base, count, count, NULL, 0);
+
+    p = (unsigned char *)(base + 1);
+    while (bytes) {
+        const size_t n = bytes < chunk_size ? bytes : chunk_size;
+        if (cvector_file_read_all(file, fd, p, n) != 0 || cvector_file_read_all(file, fd, checksum, sizeof(checksum)) != 0) {
+            cvector_clib_free(base);
+            return NULL;
+        }
+        if (cvector_file_get32(checksum) != cvector_file_adler32(p, n)) {
+            cvector_clib_free(base);
+            errno = EINVAL;
+            return NULL;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return base + 1;
+}
+
+#endif /* CVECTOR_FILE_IMPLEMENTATION */
+
+#endif /* CVECTOR_FILE_H_ */
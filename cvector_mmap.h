@@ -0,0 +1,430 @@
+#ifndef CVECTOR_MMAP_H_
+#define CVECTOR_MMAP_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief mmap backed allocators for very large vectors
+ * @file cvector_mmap.h
+ */
+
+/* Blocks of at least CVECTOR_MMAP_THRESHOLD bytes are mapped directly with
+ * mmap, smaller ones come from the cvector_clib_* functions. A mapped block
+ * grows (and shrinks) with mremap(MREMAP_MAYMOVE), which moves the pages
+ * instead of copying their contents, so doubling a vector of several hundred
+ * megabytes costs a page table update rather than a full copy. cvector_free
+ * returns mapped blocks to the kernel with munmap.
+ *
+ * mremap is Linux specific and is only declared when _GNU_SOURCE is defined
+ * before the first system header is included. Without it (or on other POSIX
+ * systems) growing a mapped block falls back to mmap, memcpy and munmap.
+ *
+ * A cvector_vm_t instead reserves a fixed range of address space for each of
+ * its vectors up front (PROT_NONE, so it costs no memory) and commits pages
+ * at the end of that range as the vector grows. Such a vector never moves:
+ * pointers into it stay valid across push_back, reserve and shrink_to_fit,
+ * and growing never copies. It can not grow beyond the reserved range,
+ * cvector_grow asserts if it tries to. Shrinking decommits the pages which
+ * are no longer needed.
+ *
+ * cvector_huge_allocator maps blocks of at least CVECTOR_HUGEPAGE_THRESHOLD
+ * bytes at an address aligned to CVECTOR_HUGEPAGE_SIZE, in whole huge pages,
+ * and marks them with madvise(MADV_HUGEPAGE), so that with transparent huge
+ * pages enabled ("madvise" or "always" in
+ * /sys/kernel/mm/transparent_hugepage/enabled) the kernel backs them with
+ * huge pages and random access needs far fewer TLB entries. Growing tries to
+ * extend the mapping in place and otherwise moves the pages with mremap to a
+ * new aligned address, shrinking always happens in place, so the alignment
+ * is kept either way. Smaller blocks are handled like cvector_mmap_allocator.
+ *
+ * This header contains declarations only, in exactly one translation unit
+ * define CVECTOR_MMAP_IMPLEMENTATION before including it:
+ *
+ * #define _GNU_SOURCE
+ * #define CVECTOR_MMAP_IMPLEMENTATION
+ * #include "cvector_mmap.h"
+ *
+ * ex:
+ *
+ * cvector_vector_type(int) v = NULL;
+ * cvector_init_mmap(v, 0, NULL);
+ * cvector_push_back(v, 42);
+ * cvector_free(v);
+ *
+ * cvector_vector_type(int) h = NULL;
+ * cvector_init_huge(h, 0, NULL);
+ * cvector_push_back(h, 42);
+ * cvector_free(h);
+ *
+ * cvector_vm_t vm;
+ * cvector_vector_type(int) w = NULL;
+ * cvector_vm_init(&vm, (size_t)1 << 30);
+ * cvector_init_vm(w, 0, NULL, &vm);
+ * cvector_push_back(w, 42);
+ * cvector_free(w);
+ */
+#include "cvector.h"
+
+/* blocks of at least this many bytes are mapped instead of allocated */
+#ifndef CVECTOR_MMAP_THRESHOLD
+#define CVECTOR_MMAP_THRESHOLD ((size_t)1 << 20)
+#endif
+
+/* size and alignment of a (transparent) huge page */
+#ifndef CVECTOR_HUGEPAGE_SIZE
+#define CVECTOR_HUGEPAGE_SIZE ((size_t)2 << 20)
+#endif
+
+/* blocks of at least this many bytes are backed by huge pages, so that
+ * rounding up to whole huge pages wastes at most 1/8 of the block */
+#ifndef CVECTOR_HUGEPAGE_THRESHOLD
+#define CVECTOR_HUGEPAGE_THRESHOLD (CVECTOR_HUGEPAGE_SIZE * 8)
+#endif
+
+/* address space reserved for each vector of cvector_vm_allocator, 4 GiB (256 MiB on 32 bit systems) */
+#ifndef CVECTOR_VM_DEFAULT_RESERVE
+#define CVECTOR_VM_DEFAULT_RESERVE ((size_t)1 << (sizeof(size_t) >= 8 ? 32 : 28))
+#endif
+
+/* NOTE: vectors refer to `allocator`, which refers back to the cvector_vm_t,
+ * so it must not be moved or copied once it has been initialized, and it must
+ * outlive its vectors. */
+typedef struct cvector_vm_t {
+    cvector_allocator_t allocator; /* the allocator which vectors of this cvector_vm_t refer to */
+    size_t reserve;                /* bytes of address space reserved for each vector, a multiple of the page size */
+} cvector_vm_t;
+
+/* the mmap allocator, shared by every thread */
+extern const cvector_allocator_t cvector_mmap_allocator;
+
+/* the huge page allocator, shared by every thread */
+extern const cvector_allocator_t cvector_huge_allocator;
+
+/* a reserve-and-commit allocator reserving CVECTOR_VM_DEFAULT_RESERVE bytes per vector, shared by every
+ * thread, for use with cvector_init_with_allocator */
+extern const cvector_allocator_t cvector_vm_allocator;
+
+/**
+ * @brief cvector_vm_init - prepares a reserve-and-commit allocator, nothing is reserved until a vector uses it
+ * @param vm - the cvector_vm_t
+ * @param reserve - bytes of address space reserved for each vector, which bounds the capacity of its vectors
+ * @return void
+ */
+void cvector_vm_init(cvector_vm_t *vm, size_t reserve);
+
+/**
+ * @brief cvector_init_mmap - Initialize a vector whose storage is mapped with mmap once it is large enough.
+ * The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_mmap(vec, capacity, elem_destructor_fn) \
+    cvector_init_with_allocator((vec), (capacity), (elem_destructor_fn), &cvector_mmap_allocator)
+
+/**
+ * @brief cvector_init_huge - Initialize a vector whose storage is backed by transparent huge pages once it is large enough.
+ * The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_huge(vec, capacity, elem_destructor_fn) \
+    cvector_init_with_allocator((vec), (capacity), (elem_destructor_fn), &cvector_huge_allocator)
+
+/**
+ * @brief cvector_init_vm - Initialize a vector which never moves, its storage is committed page by page
+ * inside address space reserved by `vm`. The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @param vm - pointer to the cvector_vm_t
+ * @return void
+ */
+#define cvector_init_vm(vec, capacity, elem_destructor_fn, vm) \
+    cvector_init_with_allocator((vec), (capacity), (elem_destructor_fn), &(vm)->allocator)
+
+#ifdef CVECTOR_MMAP_IMPLEMENTATION
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+static size_t cvector_mmap_page_size(void) {
+    static size_t page_size;
+    if (!page_size) {
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+    }
+    return page_size;
+}
+
+static size_t cvector_mmap_round_to_page(size_t size) {
+    const size_t page_size = cvector_mmap_page_size();
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static void *cvector_mmap_map(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void *cvector_mmap_malloc_fn(void *ctx, size_t size) {
+    (void)ctx;
+
+    if (size < CVECTOR_MMAP_THRESHOLD) {
+        return cvector_clib_malloc(size);
+    }
+    return cvector_mmap_map(size);
+}
+
+static void cvector_mmap_free_fn(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+
+    if (size < CVECTOR_MMAP_THRESHOLD) {
+        cvector_clib_free(ptr);
+        return;
+    }
+    munmap(ptr, size);
+}
+
+static void *cvector_mmap_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    void *p;
+
+    if (old_size < CVECTOR_MMAP_THRESHOLD && new_size < CVECTOR_MMAP_THRESHOLD) {
+        return cvector_clib_realloc(ptr, new_size);
+    }
+
+#ifdef MREMAP_MAYMOVE
+    if (old_size >= CVECTOR_MMAP_THRESHOLD && new_size >= CVECTOR_MMAP_THRESHOLD) {
+        /* the kernel moves the pages, nothing is copied */
+        p = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+        return p == MAP_FAILED ? NULL : p;
+    }
+#endif
+
+    /* the block crosses the threshold (or mremap is unavailable) */
+    p = cvector_mmap_malloc_fn(ctx, new_size);
+    if (p) {
+        cvector_clib_memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        cvector_mmap_free_fn(ctx, ptr, old_size);
+    }
+    return p;
+}
+
+static size_t cvector_mmap_good_size_fn(void *ctx, size_t size) {
+    (void)ctx;
+
+    if (size < CVECTOR_MMAP_THRESHOLD) {
+        return size;
+    }
+
+    /* a mapping always covers whole pages */
+    return cvector_mmap_round_to_page(size);
+}
+
+const cvector_allocator_t cvector_mmap_allocator = {
+    cvector_mmap_malloc_fn,
+    cvector_mmap_realloc_fn,
+    cvector_mmap_free_fn,
+    NULL,
+    cvector_mmap_good_size_fn,
+};
+
+static size_t cvector_huge_round(size_t size) {
+    return (size + CVECTOR_HUGEPAGE_SIZE - 1) & ~(CVECTOR_HUGEPAGE_SIZE - 1);
+}
+
+static void cvector_huge_advise(void *ptr, size_t size) {
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, size, MADV_HUGEPAGE);
+#else
+    (void)ptr;
+    (void)size;
+#endif
+}
+
+/* maps `size` bytes, a multiple of CVECTOR_HUGEPAGE_SIZE, at an address aligned to CVECTOR_HUGEPAGE_SIZE */
+static void *cvector_huge_map(size_t size) {
+    char *p = (char *)mmap(NULL, size + CVECTOR_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    char *aligned;
+
+    if (p == (char *)MAP_FAILED) {
+        return NULL;
+    }
+
+    /* trim the over-allocation in front of and behind the aligned range */
+    aligned = (char *)(((size_t)p + CVECTOR_HUGEPAGE_SIZE - 1) & ~(CVECTOR_HUGEPAGE_SIZE - 1));
+    if (aligned != p) {
+        munmap(p, (size_t)(aligned - p));
+    }
+    munmap(aligned + size, (size_t)(p + CVECTOR_HUGEPAGE_SIZE - aligned));
+
+    cvector_huge_advise(aligned, size);
+    return aligned;
+}
+
+static void *cvector_huge_malloc_fn(void *ctx, size_t size) {
+    if (size < CVECTOR_HUGEPAGE_THRESHOLD) {
+        return cvector_mmap_malloc_fn(ctx, size);
+    }
+    return cvector_huge_map(cvector_huge_round(size));
+}
+
+static void cvector_huge_free_fn(void *ctx, void *ptr, size_t size) {
+    if (size < CVECTOR_HUGEPAGE_THRESHOLD) {
+        cvector_mmap_free_fn(ctx, ptr, size);
+        return;
+    }
+    munmap(ptr, cvector_huge_round(size));
+}
+
+static void *cvector_huge_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    void *p;
+
+    if (old_size < CVECTOR_HUGEPAGE_THRESHOLD && new_size < CVECTOR_HUGEPAGE_THRESHOLD) {
+        return cvector_mmap_realloc_fn(ctx, ptr, old_size, new_size);
+    }
+
+#if defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+    if (old_size >= CVECTOR_HUGEPAGE_THRESHOLD && new_size >= CVECTOR_HUGEPAGE_THRESHOLD) {
+        const size_t old_mapped = cvector_huge_round(old_size);
+        const size_t new_mapped = cvector_huge_round(new_size);
+        void *dest;
+
+        if (old_mapped == new_mapped) {
+            return ptr;
+        }
+
+        /* shrinking, or growing into free address space, keeps the address */
+        p = mremap(ptr, old_mapped, new_mapped, 0);
+        if (p != MAP_FAILED) {
+            cvector_huge_advise(p, new_mapped);
+            return p;
+        }
+
+        /* otherwise move the pages, without copying, to a new aligned range */
+        dest = cvector_huge_map(new_mapped);
+        if (!dest) {
+            return NULL;
+        }
+        p = mremap(ptr, old_mapped, new_mapped, MREMAP_MAYMOVE | MREMAP_FIXED, dest);
+        if (p == MAP_FAILED) {
+            munmap(dest, new_mapped);
+            return NULL;
+        }
+        cvector_huge_advise(p, new_mapped);
+        return p;
+    }
+#endif
+
+    /* the block crosses the threshold (or mremap is unavailable) */
+    p = cvector_huge_malloc_fn(ctx, new_size);
+    if (p) {
+        cvector_clib_memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        cvector_huge_free_fn(ctx, ptr, old_size);
+    }
+    return p;
+}
+
+static size_t cvector_huge_good_size_fn(void *ctx, size_t size) {
+    if (size < CVECTOR_HUGEPAGE_THRESHOLD) {
+        return cvector_mmap_good_size_fn(ctx, size);
+    }
+    return cvector_huge_round(size);
+}
+
+const cvector_allocator_t cvector_huge_allocator = {
+    cvector_huge_malloc_fn,
+    cvector_huge_realloc_fn,
+    cvector_huge_free_fn,
+    NULL,
+    cvector_huge_good_size_fn,
+};
+
+static size_t cvector_vm_reserve(void *ctx) {
+    return ctx ? ((cvector_vm_t *)ctx)->reserve : CVECTOR_VM_DEFAULT_RESERVE;
+}
+
+static void *cvector_vm_malloc_fn(void *ctx, size_t size) {
+    const size_t reserve = cvector_vm_reserve(ctx);
+    void *p;
+
+    if (size > reserve) {
+        return NULL;
+    }
+
+    p = mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (mprotect(p, cvector_mmap_round_to_page(size), PROT_READ | PROT_WRITE) != 0) {
+        munmap(p, reserve);
+        return NULL;
+    }
+    return p;
+}
+
+static void *cvector_vm_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    const size_t old_committed = cvector_mmap_round_to_page(old_size);
+    const size_t new_committed = cvector_mmap_round_to_page(new_size);
+
+    if (new_size > cvector_vm_reserve(ctx)) {
+        return NULL;
+    }
+
+    if (new_committed > old_committed) {
+        if (mprotect((char *)ptr + old_committed, new_committed - old_committed, PROT_READ | PROT_WRITE) != 0) {
+            return NULL;
+        }
+    } else if (new_committed < old_committed) {
+        /* mapping fresh PROT_NONE pages over the tail gives its memory back to the kernel */
+        void *p = mmap((char *)ptr + new_committed, old_committed - new_committed, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+        if (p == MAP_FAILED) {
+            return NULL;
+        }
+    }
+
+    /* the vector never moves */
+    return ptr;
+}
+
+static void cvector_vm_free_fn(void *ctx, void *ptr, size_t size) {
+    (void)size;
+    munmap(ptr, cvector_vm_reserve(ctx));
+}
+
+static size_t cvector_vm_good_size_fn(void *ctx, size_t size) {
+    /* the last step of growth only gets what is left of the reserve */
+    const size_t reserve = cvector_vm_reserve(ctx);
+    return size < reserve ? cvector_mmap_round_to_page(size) : reserve;
+}
+
+const cvector_allocator_t cvector_vm_allocator = {
+    cvector_vm_malloc_fn,
+    cvector_vm_realloc_fn,
+    cvector_vm_free_fn,
+    NULL,
+    cvector_vm_good_size_fn,
+};
+
+void cvector_vm_init(cvector_vm_t *vm, size_t reserve) {
+    vm->allocator.malloc_fn    = cvector_vm_malloc_fn;
+    vm->allocator.realloc_fn   = cvector_vm_realloc_fn;
+    vm->allocator.free_fn      = cvector_vm_free_fn;
+    vm->allocator.ctx          = vm;
+    vm->allocator.good_size_fn = cvector_vm_good_size_fn;
+    vm->reserve                = cvector_mmap_round_to_page(reserve);
+}
+
+#endif /* CVECTOR_MMAP_IMPLEMENTATION */
+
+#endif /* CVECTOR_MMAP_H_ */
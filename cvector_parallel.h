@@ -0,0 +1,894 @@
+#ifndef CVECTOR_PARALLEL_H_
+#define CVECTOR_PARALLEL_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief running a function over the elements of a vector on several threads
+ * @file cvector_parallel.h
+ */
+
+/* The parallel algorithms split the elements into chunks and run the chunks
+ * on a pool of threads. The calling thread takes part in the work, and
+ * vectors with fewer than CVECTOR_PARALLEL_CUTOFF elements are processed on
+ * the calling thread alone, since waking the pool would cost more than it
+ * saves.
+ *
+ * Chunks are about CVECTOR_PARALLEL_CHUNK bytes of elements, rounded up to
+ * whole cache lines when elements evenly divide a cache line, so two threads
+ * only ever share the cache line at the border of their chunks. Every
+ * participating thread starts with an equal contiguous share of the chunks
+ * and claims them one by one with an atomic counter. A thread which is done
+ * with its share steals the remaining chunks of the other threads from the
+ * same counters, so a few slow chunks do not leave the other threads idle.
+ *
+ * The pool is reused between calls. The algorithms run on a default pool with
+ * one thread per online CPU, which is created the first time it is needed and
+ * destroyed at exit. Pools of other sizes are created with
+ * cvector_thread_pool_create and used through the *_n functions. A pool runs
+ * one algorithm at a time, so the function which is run must not itself run
+ * a parallel algorithm on the same pool.
+ *
+ * This header contains declarations only, in exactly one translation unit
+ * define CVECTOR_PARALLEL_IMPLEMENTATION before including it, and link with
+ * pthreads:
+ *
+ * #define CVECTOR_PARALLEL_IMPLEMENTATION
+ * #include "cvector_parallel.h"
+ *
+ * ex:
+ *
+ * static void score(void *elem, void *ctx) { ((struct item *)elem)->score = ...; }
+ * cvector_parallel_for_each(items, score, NULL);
+ */
+#include "cvector.h"
+
+/* vectors with fewer elements than this are processed by the calling thread */
+#ifndef CVECTOR_PARALLEL_CUTOFF
+#define CVECTOR_PARALLEL_CUTOFF 16384
+#endif
+
+/* the size of a chunk of elements in bytes, before rounding to cache lines */
+#ifndef CVECTOR_PARALLEL_CHUNK
+#define CVECTOR_PARALLEL_CHUNK 16384
+#endif
+
+typedef struct cvector_thread_pool_t cvector_thread_pool_t;
+
+/* called by cvector_parallel_run for the elements [first, last) */
+typedef void (*cvector_parallel_kernel_t)(void *arg, size_t first, size_t last);
+
+/* called by cvector_parallel_for_each for each element */
+typedef void (*cvector_parallel_for_each_fn)(void *elem, void *ctx);
+
+/* called by cvector_parallel_transform for each element, writes the result to `out` */
+typedef void (*cvector_parallel_transform_fn)(const void *in, void *out, void *ctx);
+
+/* called by cvector_parallel_reduce and the scans to combine `elem` into `acc`, must be associative */
+typedef void (*cvector_parallel_op_fn)(void *acc, const void *elem);
+
+/**
+ * @brief cvector_thread_pool_create - starts a pool of threads for the parallel algorithms
+ * @param threads - the number of threads working on each algorithm, including the calling thread, 0 for one per online CPU
+ * @return the pool, or NULL if a thread could not be started
+ */
+cvector_thread_pool_t *cvector_thread_pool_create(size_t threads);
+
+/**
+ * @brief cvector_thread_pool_destroy - stops the threads of a pool and frees it, once no algorithm runs on it
+ * @param pool - the pool
+ * @return void
+ */
+void cvector_thread_pool_destroy(cvector_thread_pool_t *pool);
+
+/**
+ * @brief cvector_thread_pool_size - gets the number of threads working on each algorithm, including the calling thread
+ * @param pool - the pool, or NULL for the default pool
+ * @return the number of threads
+ */
+size_t cvector_thread_pool_size(cvector_thread_pool_t *pool);
+
+/**
+ * @brief cvector_parallel_run - calls `kernel` on chunks of `grain` indices which together cover [0, count), and waits for all of them
+ * @param pool - the pool, or NULL for the default pool
+ * @param count - the number of indices
+ * @param grain - the number of indices in a chunk (the last one may be shorter)
+ * @param kernel - the function which processes a chunk, called from several threads at once
+ * @param arg - passed to `kernel`
+ * @return void
+ */
+void cvector_parallel_run(cvector_thread_pool_t *pool, size_t count, size_t grain, cvector_parallel_kernel_t kernel, void *arg);
+
+/**
+ * @brief cvector_parallel_grain - the number of elements of `elem_size` bytes in a chunk
+ * @param elem_size - size of an element in bytes
+ * @return the number of elements, a multiple of the number of elements in a cache line if elements are smaller than one
+ */
+size_t cvector_parallel_grain(size_t elem_size);
+
+/**
+ * @brief cvector_parallel_for_each_n - calls `func` on a pointer to each of `count` elements of `elem_size` bytes, see cvector_parallel_for_each
+ * @return void
+ */
+void cvector_parallel_for_each_n(cvector_thread_pool_t *pool, void *data, size_t count, size_t elem_size, cvector_parallel_for_each_fn func, void *ctx);
+
+/**
+ * @brief cvector_parallel_transform_n - calls `func` on each of `count` elements at `in` and the corresponding element at `out`, see cvector_parallel_transform
+ * @return void
+ */
+void cvector_parallel_transform_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t in_size, size_t out_size, cvector_parallel_transform_fn func, void *ctx);
+
+/**
+ * @brief cvector_parallel_reduce_n - combines each of `count` elements of `elem_size` bytes into `acc` with `op`, see cvector_parallel_reduce
+ * @return void
+ */
+void cvector_parallel_reduce_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc, cvector_parallel_op_fn op);
+
+/**
+ * @brief cvector_parallel_scan_n - writes the running combination of `count` elements at `in` to `out`, see cvector_inclusive_scan and cvector_exclusive_scan
+ * @param init - the first element of an exclusive scan, which may be `out`, or NULL for an inclusive scan
+ * @return void
+ */
+void cvector_parallel_scan_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t elem_size, const void *init, cvector_parallel_op_fn op);
+
+/**
+ * @brief cvector_parallel_sum_n - adds each of `count` integers of `elem_size` bytes to the integer of the same type at `acc`, see cvector_parallel_sum
+ * @return void
+ */
+void cvector_parallel_sum_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc);
+
+/**
+ * @brief cvector_parallel_fsum_n - adds each of `count` floats or doubles (as given by `elem_size`) to the one at `acc`, see cvector_parallel_fsum
+ * @return void
+ */
+void cvector_parallel_fsum_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc);
+
+/**
+ * @brief cvector_parallel_sum_scan_n - writes the running sums of `count` integers at `in` to `out`, which may be `in`, see cvector_inclusive_sum and cvector_exclusive_sum
+ * @param init - the first element of an exclusive scan, or NULL for an inclusive scan
+ * @return void
+ */
+void cvector_parallel_sum_scan_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t elem_size, const void *init);
+
+/**
+ * @brief cvector_parallel_check_integer - For internal use, fails to compile unless the elements of `vec` are integers
+ * @param vec - the vector
+ * @return void
+ * @internal
+ */
+#define cvector_parallel_check_integer(vec) ((void)sizeof(*(vec) % 1))
+
+/**
+ * @brief cvector_parallel_for_each - call function func with a pointer to each element of the vector, on the default pool
+ * @param vec - the vector
+ * @param func - a cvector_parallel_for_each_fn, called from several threads at once
+ * @param ctx - passed to each call of func
+ * @return void
+ */
+#define cvector_parallel_for_each(vec, func, ctx) \
+    cvector_parallel_for_each_n(NULL, (vec), cvector_size(vec), sizeof(*(vec)), (func), (ctx))
+
+/**
+ * @brief cvector_parallel_transform - resizes `to` to the size of `from` and sets each of its elements to func applied to the corresponding element of `from`, on the default pool
+ * @param from - the input vector
+ * @param to - the output vector, a different vector whose existing elements are overwritten
+ * @param func - a cvector_parallel_transform_fn, called from several threads at once
+ * @param ctx - passed to each call of func
+ * @return void
+ */
+#define cvector_parallel_transform(from, to, func, ctx)                                                                      \
+    do {                                                                                                                     \
+        cvector_resize_uninit((to), cvector_size(from));                                                                     \
+        cvector_parallel_transform_n(NULL, (from), (to), cvector_size(from), sizeof(*(from)), sizeof(*(to)), (func), (ctx)); \
+    } while (0)
+
+/**
+ * @brief cvector_parallel_reduce - sets `result` to `init` and combines each element of the vector into it with op, on the default pool
+ * @param vec - the vector
+ * @param init - the initial value
+ * @param op - a cvector_parallel_op_fn, called from several threads at once, the elements are combined in order but grouped arbitrarily
+ * @param result - an lvalue of the element type which receives the result
+ * @return void
+ */
+#define cvector_parallel_reduce(vec, init, op, result)                                              \
+    do {                                                                                            \
+        cvector_clib_assert(sizeof(result) == sizeof(*(vec)));                                      \
+        (result) = (init);                                                                          \
+        cvector_parallel_reduce_n(NULL, (vec), cvector_size(vec), sizeof(*(vec)), &(result), (op)); \
+    } while (0)
+
+/**
+ * @brief cvector_inclusive_scan - resizes `to` to the size of `from` and sets each of its elements to the combination of the elements of `from` up to and including the same index, on the default pool
+ * @param from - the input vector
+ * @param to - the output vector, a different vector whose existing elements are overwritten
+ * @param op - a cvector_parallel_op_fn, called from several threads at once
+ * @return void
+ */
+#define cvector_inclusive_scan(from, to, op)                                                          \
+    do {                                                                                              \
+        cvector_clib_assert(sizeof(*(to)) == sizeof(*(from)));                                        \
+        cvector_resize_uninit((to), cvector_size(from));                                              \
+        cvector_parallel_scan_n(NULL, (from), (to), cvector_size(from), sizeof(*(from)), NULL, (op)); \
+    } while (0)
+
+/**
+ * @brief cvector_exclusive_scan - resizes `to` to the size of `from` and sets each of its elements to `init` combined with the elements of `from` before the same index, on the default pool
+ * @param from - the input vector
+ * @param to - the output vector, a different vector whose existing elements are overwritten
+ * @param init - the first element of `to`
+ * @param op - a cvector_parallel_op_fn, called from several threads at once
+ * @return void
+ */
+#define cvector_exclusive_scan(from, to, init, op)                                                        \
+    do {                                                                                                  \
+        cvector_clib_assert(sizeof(*(to)) == sizeof(*(from)));                                            \
+        cvector_resize_uninit((to), cvector_size(from));                                                  \
+        if (cvector_size(to)) {                                                                           \
+            (to)[0] = (init);                                                                             \
+            cvector_parallel_scan_n(NULL, (from), (to), cvector_size(from), sizeof(*(from)), (to), (op)); \
+        }                                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_parallel_sum - sets `result` to `init` plus the sum of the elements of an integer vector, on the default pool
+ * @param vec - the vector, of any integer type, which is summed with the wrap around of the unsigned type of the same size
+ * @param init - the initial value
+ * @param result - an lvalue of the element type which receives the sum
+ * @return void
+ */
+#define cvector_parallel_sum(vec, init, result)                                            \
+    do {                                                                                   \
+        cvector_parallel_check_integer(vec);                                               \
+        cvector_clib_assert(sizeof(result) == sizeof(*(vec)));                             \
+        (result) = (init);                                                                 \
+        cvector_parallel_sum_n(NULL, (vec), cvector_size(vec), sizeof(*(vec)), &(result)); \
+    } while (0)
+
+/**
+ * @brief cvector_parallel_fsum - sets `result` to `init` plus the sum of the elements of a float or double vector, on the default pool
+ * @param vec - the vector, which is summed in a different order than a loop would, so the rounding differs
+ * @param init - the initial value
+ * @param result - an lvalue of the element type which receives the sum
+ * @return void
+ */
+#define cvector_parallel_fsum(vec, init, result)                                            \
+    do {                                                                                    \
+        cvector_clib_assert(sizeof(result) == sizeof(*(vec)));                              \
+        (result) = (init);                                                                  \
+        cvector_parallel_fsum_n(NULL, (vec), cvector_size(vec), sizeof(*(vec)), &(result)); \
+    } while (0)
+
+/**
+ * @brief cvector_inclusive_sum - like cvector_inclusive_scan with addition, for integer vectors
+ * @param from - the input vector
+ * @param to - the output vector, a different vector whose existing elements are overwritten
+ * @return void
+ */
+#define cvector_inclusive_sum(from, to)                                                             \
+    do {                                                                                            \
+        cvector_parallel_check_integer(from);                                                       \
+        cvector_clib_assert(sizeof(*(to)) == sizeof(*(from)));                                      \
+        cvector_resize_uninit((to), cvector_size(from));                                            \
+        cvector_parallel_sum_scan_n(NULL, (from), (to), cvector_size(from), sizeof(*(from)), NULL); \
+    } while (0)
+
+/**
+ * @brief cvector_exclusive_sum - like cvector_exclusive_scan with addition, for integer vectors, ex: the row offsets of a CSR matrix from the row lengths
+ * @param from - the input vector
+ * @param to - the output vector, a different vector whose existing elements are overwritten
+ * @param init - the first element of `to`
+ * @return void
+ */
+#define cvector_exclusive_sum(from, to, init)                                                           \
+    do {                                                                                                \
+        cvector_parallel_check_integer(from);                                                           \
+        cvector_clib_assert(sizeof(*(to)) == sizeof(*(from)));                                          \
+        cvector_resize_uninit((to), cvector_size(from));                                                \
+        if (cvector_size(to)) {                                                                         \
+            (to)[0] = (init);                                                                           \
+            cvector_parallel_sum_scan_n(NULL, (from), (to), cvector_size(from), sizeof(*(from)), (to)); \
+        }                                                                                               \
+    } while (0)
+
+#ifdef CVECTOR_PARALLEL_IMPLEMENTATION
+
+#include "cvector_atomic.h"
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* the chunks handed to one thread, which it and thieves claim with `next` */
+typedef struct cvector_parallel_share_t {
+    cvector_atomic_size_t next;
+    size_t end;
+    char pad[CVECTOR_CACHE_LINE - sizeof(cvector_atomic_size_t) - sizeof(size_t)];
+} cvector_parallel_share_t;
+
+struct cvector_thread_pool_t {
+    pthread_mutex_t run_lock; /* held while an algorithm runs */
+    pthread_mutex_t lock;     /* protects everything below */
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    unsigned long generation;
+    size_t running;
+    int stop;
+
+    /* the current algorithm */
+    cvector_parallel_kernel_t kernel;
+    void *arg;
+    size_t count;
+    size_t grain;
+
+    size_t size; /* number of shares, the helpers plus the calling thread */
+    cvector_parallel_share_t *shares;
+    pthread_t *helpers;
+};
+
+typedef struct cvector_parallel_helper_arg_t {
+    cvector_thread_pool_t *pool;
+    size_t index;
+} cvector_parallel_helper_arg_t;
+
+static cvector_thread_pool_t *cvector_parallel_default_pool;
+static pthread_once_t cvector_parallel_default_once = PTHREAD_ONCE_INIT;
+
+/* claims and runs chunks, first from the own share and then from the others */
+static void cvector_parallel_work(cvector_thread_pool_t *pool, size_t self) {
+    size_t i;
+    for (i = 0; i < pool->size; ++i) {
+        cvector_parallel_share_t *share = &pool->shares[(self + i) % pool->size];
+        for (;;) {
+            const size_t chunk = cvector_atomic_fetch_add(&share->next, 1);
+            size_t first;
+            if (chunk >= share->end) {
+                break;
+            }
+            first = chunk * pool->grain;
+            pool->kernel(pool->arg, first, pool->count - first < pool->grain ? pool->count : first + pool->grain);
+        }
+    }
+}
+
+static void *cvector_parallel_helper(void *p) {
+    cvector_parallel_helper_arg_t *helper = (cvector_parallel_helper_arg_t *)p;
+    cvector_thread_pool_t *pool           = helper->pool;
+    const size_t self                     = helper->index;
+    unsigned long seen                    = 0;
+
+    cvector_clib_free(helper);
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        cvector_parallel_work(pool, self);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void cvector_parallel_destroy_default(void) {
+    cvector_thread_pool_destroy(cvector_parallel_default_pool);
+}
+
+static void cvector_parallel_create_default(void) {
+    cvector_parallel_default_pool = cvector_thread_pool_create(0);
+    if (cvector_parallel_default_pool) {
+        atexit(cvector_parallel_destroy_default);
+    }
+}
+
+static cvector_thread_pool_t *cvector_parallel_pool(cvector_thread_pool_t *pool) {
+    if (pool) {
+        return pool;
+    }
+    pthread_once(&cvector_parallel_default_once, cvector_parallel_create_default);
+    return cvector_parallel_default_pool;
+}
+
+static size_t cvector_parallel_chunks(size_t count, size_t grain) {
+    return count / grain + (count % grain != 0);
+}
+
+/* the pool which runs `count` indices in chunks of `grain`, or NULL if the calling thread should do it alone */
+static cvector_thread_pool_t *cvector_parallel_select(cvector_thread_pool_t *pool, size_t count, size_t grain) {
+    if (count < CVECTOR_PARALLEL_CUTOFF || grain == 0 || cvector_parallel_chunks(count, grain) < 2) {
+        return NULL;
+    }
+    pool = cvector_parallel_pool(pool);
+    return pool && pool->size > 1 ? pool : NULL;
+}
+
+/* stops and joins the first `started` helpers and frees the pool */
+static void cvector_parallel_shutdown(cvector_thread_pool_t *pool, size_t started) {
+    size_t i;
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (i = 0; i < started; ++i) {
+        pthread_join(pool->helpers[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    cvector_clib_free(pool->helpers);
+    cvector_clib_free(pool->shares);
+    cvector_clib_free(pool);
+}
+
+cvector_thread_pool_t *cvector_thread_pool_create(size_t threads) {
+    cvector_thread_pool_t *pool;
+    size_t i;
+
+    if (threads == 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads         = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    pool = (cvector_thread_pool_t *)cvector_clib_calloc(1, sizeof(*pool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->size    = threads;
+    pool->shares  = (cvector_parallel_share_t *)cvector_clib_calloc(threads, sizeof(*pool->shares));
+    pool->helpers = (pthread_t *)cvector_clib_calloc(threads, sizeof(*pool->helpers));
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    if (!pool->shares || !pool->helpers) {
+        cvector_parallel_shutdown(pool, 0);
+        return NULL;
+    }
+
+    /* share 0 belongs to the calling thread */
+    for (i = 1; i < threads; ++i) {
+        cvector_parallel_helper_arg_t *helper = (cvector_parallel_helper_arg_t *)cvector_clib_malloc(sizeof(*helper));
+        if (helper) {
+            helper->pool  = pool;
+            helper->index = i;
+        }
+        if (!helper || pthread_create(&pool->helpers[i - 1], NULL, cvector_parallel_helper, helper) != 0) {
+            cvector_clib_free(helper);
+            cvector_parallel_shutdown(pool, i - 1);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void cvector_thread_pool_destroy(cvector_thread_pool_t *pool) {
+    if (pool) {
+        cvector_parallel_shutdown(pool, pool->size - 1);
+    }
+}
+
+size_t cvector_thread_pool_size(cvector_thread_pool_t *pool) {
+    pool = cvector_parallel_pool(pool);
+    return pool ? pool->size : 1;
+}
+
+void cvector_parallel_run(cvector_thread_pool_t *pool, size_t count, size_t grain, cvector_parallel_kernel_t kernel, void *arg) {
+    size_t chunks;
+    size_t i;
+
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    chunks = cvector_parallel_chunks(count, grain);
+    pool   = cvector_parallel_select(pool, count, grain);
+    if (!pool) {
+        kernel(arg, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+    pool->kernel = kernel;
+    pool->arg    = arg;
+    pool->count  = count;
+    pool->grain  = grain;
+    for (i = 0; i < pool->size; ++i) {
+        cvector_atomic_init(&pool->shares[i].next, chunks * i / pool->size);
+        pool->shares[i].end = chunks * (i + 1) / pool->size;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    ++pool->generation;
+    pool->running = pool->size - 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    cvector_parallel_work(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+size_t cvector_parallel_grain(size_t elem_size) {
+    size_t grain;
+    if (elem_size == 0) {
+        return CVECTOR_PARALLEL_CHUNK;
+    }
+    grain = CVECTOR_PARALLEL_CHUNK / elem_size;
+    if (elem_size < CVECTOR_CACHE_LINE && CVECTOR_CACHE_LINE % elem_size == 0) {
+        /* round up to whole cache lines */
+        const size_t per_line = CVECTOR_CACHE_LINE / elem_size;
+        grain                 = (grain + per_line - 1) / per_line * per_line;
+    }
+    return grain ? grain : 1;
+}
+
+typedef struct cvector_parallel_for_each_arg_t {
+    char *data;
+    size_t elem_size;
+    cvector_parallel_for_each_fn func;
+    void *ctx;
+} cvector_parallel_for_each_arg_t;
+
+static void cvector_parallel_for_each_kernel(void *p, size_t first, size_t last) {
+    const cvector_parallel_for_each_arg_t *arg = (const cvector_parallel_for_each_arg_t *)p;
+    char *elem                                 = arg->data + first * arg->elem_size;
+    for (; first < last; ++first, elem += arg->elem_size) {
+        arg->func(elem, arg->ctx);
+    }
+}
+
+void cvector_parallel_for_each_n(cvector_thread_pool_t *pool, void *data, size_t count, size_t elem_size, cvector_parallel_for_each_fn func, void *ctx) {
+    cvector_parallel_for_each_arg_t arg;
+    arg.data      = (char *)data;
+    arg.elem_size = elem_size;
+    arg.func      = func;
+    arg.ctx       = ctx;
+    cvector_parallel_run(pool, count, cvector_parallel_grain(elem_size), cvector_parallel_for_each_kernel, &arg);
+}
+
+typedef struct cvector_parallel_transform_arg_t {
+    const char *in;
+    char *out;
+    size_t in_size;
+    size_t out_size;
+    cvector_parallel_transform_fn func;
+    void *ctx;
+} cvector_parallel_transform_arg_t;
+
+static void cvector_parallel_transform_kernel(void *p, size_t first, size_t last) {
+    const cvector_parallel_transform_arg_t *arg = (const cvector_parallel_transform_arg_t *)p;
+    const char *in                              = arg->in + first * arg->in_size;
+    char *out                                   = arg->out + first * arg->out_size;
+    for (; first < last; ++first, in += arg->in_size, out += arg->out_size) {
+        arg->func(in, out, arg->ctx);
+    }
+}
+
+void cvector_parallel_transform_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t in_size, size_t out_size, cvector_parallel_transform_fn func, void *ctx) {
+    cvector_parallel_transform_arg_t arg;
+    arg.in       = (const char *)in;
+    arg.out      = (char *)out;
+    arg.in_size  = in_size;
+    arg.out_size = out_size;
+    arg.func     = func;
+    arg.ctx      = ctx;
+    /* the chunks follow the larger of the two elements, so neither side shares cache lines more often */
+    cvector_parallel_run(pool, count, cvector_parallel_grain(in_size > out_size ? in_size : out_size), cvector_parallel_transform_kernel, &arg);
+}
+
+/* Reductions and scans run in two passes over the same chunks. The first pass
+ * reduces each chunk to a partial result, the partials are combined in order
+ * on the calling thread, and the second pass scans each chunk starting from
+ * the combination of the chunks before it. A reduction only needs the first
+ * pass, and a scan on the calling thread alone only needs the second.
+ *
+ * The sums combine elements with the function pointers below, which for the
+ * arithmetic types are loops over eight independent accumulators that
+ * compilers turn into SIMD code, and otherwise call the user's op. */
+
+/* combines `count` elements at `data` into `acc` */
+typedef void (*cvector_parallel_reduce_fn)(cvector_parallel_op_fn op, void *acc, const void *data, size_t count, size_t elem_size);
+
+/* scans `count` elements starting from `seed`, see cvector_parallel_scan_n for `exclusive` */
+typedef void (*cvector_parallel_scan_fn)(cvector_parallel_op_fn op, void *out, const void *in, size_t count, size_t elem_size, const void *seed, int exclusive);
+
+static void cvector_parallel_reduce_op(cvector_parallel_op_fn op, void *acc, const void *data, size_t count, size_t elem_size) {
+    const char *elem = (const char *)data;
+    for (; count; --count, elem += elem_size) {
+        op(acc, elem);
+    }
+}
+
+static void cvector_parallel_scan_op(cvector_parallel_op_fn op, void *out, const void *in, size_t count, size_t elem_size, const void *seed, int exclusive) {
+    char *dst       = (char *)out;
+    const char *src = (const char *)in;
+    size_t i;
+    if (count == 0) {
+        return;
+    }
+    if (exclusive) {
+        cvector_clib_memmove(dst, seed, elem_size);
+        for (i = 1; i < count; ++i) {
+            cvector_clib_memcpy(dst + i * elem_size, dst + (i - 1) * elem_size, elem_size);
+            op(dst + i * elem_size, src + (i - 1) * elem_size);
+        }
+    } else {
+        if (seed) {
+            cvector_clib_memcpy(dst, seed, elem_size);
+            op(dst, src);
+        } else {
+            cvector_clib_memcpy(dst, src, elem_size);
+        }
+        for (i = 1; i < count; ++i) {
+            cvector_clib_memcpy(dst + i * elem_size, dst + (i - 1) * elem_size, elem_size);
+            op(dst + i * elem_size, src + i * elem_size);
+        }
+    }
+}
+
+/* the elements may be of any type of the size of `type`, ex: long long for
+ * unsigned long, so they are only accessed through memcpy, which compilers
+ * turn into plain loads and stores */
+#define CVECTOR_PARALLEL_LOAD(tmp, p) \
+    (cvector_clib_memcpy(&(tmp), (p), sizeof(tmp)), (tmp))
+
+/* defines the sum of `type`, integers wrap around since they are unsigned */
+#define CVECTOR_PARALLEL_SUM_KERNEL(name, type)                                                                                       \
+    static void cvector_parallel_sum_##name(cvector_parallel_op_fn op, void *acc, const void *data, size_t count, size_t elem_size) { \
+        const type *src = (const type *)data;                                                                                         \
+        type lane[8];                                                                                                                 \
+        type sum;                                                                                                                     \
+        type load;                                                                                                                    \
+        size_t i;                                                                                                                     \
+        (void)op;                                                                                                                     \
+        (void)elem_size;                                                                                                              \
+        cvector_clib_memcpy(&sum, acc, sizeof(type));                                                                                 \
+        for (i = 0; i < 8; ++i) {                                                                                                     \
+            lane[i] = 0;                                                                                                              \
+        }                                                                                                                             \
+        for (i = 0; i + 8 <= count; i += 8) {                                                                                         \
+            lane[0] += CVECTOR_PARALLEL_LOAD(load, src + i);                                                                          \
+            lane[1] += CVECTOR_PARALLEL_LOAD(load, src + i + 1);                                                                      \
+            lane[2] += CVECTOR_PARALLEL_LOAD(load, src + i + 2);                                                                      \
+            lane[3] += CVECTOR_PARALLEL_LOAD(load, src + i + 3);                                                                      \
+            lane[4] += CVECTOR_PARALLEL_LOAD(load, src + i + 4);                                                                      \
+            lane[5] += CVECTOR_PARALLEL_LOAD(load, src + i + 5);                                                                      \
+            lane[6] += CVECTOR_PARALLEL_LOAD(load, src + i + 6);                                                                      \
+            lane[7] += CVECTOR_PARALLEL_LOAD(load, src + i + 7);                                                                      \
+        }                                                                                                                             \
+        for (; i < count; ++i) {                                                                                                      \
+            sum += CVECTOR_PARALLEL_LOAD(load, src + i);                                                                              \
+        }                                                                                                                             \
+        sum += ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));                             \
+        cvector_clib_memcpy(acc, &sum, sizeof(type));                                                                                 \
+    }
+
+/* defines the sum scan of `type` */
+#define CVECTOR_PARALLEL_SUM_SCAN_KERNEL(name, type)                                                                                                                      \
+    static void cvector_parallel_sum_scan_##name(cvector_parallel_op_fn op, void *out, const void *in, size_t count, size_t elem_size, const void *seed, int exclusive) { \
+        const type *src = (const type *)in;                                                                                                                               \
+        type *dst       = (type *)out;                                                                                                                                    \
+        type sum        = 0;                                                                                                                                              \
+        type load;                                                                                                                                                        \
+        size_t i;                                                                                                                                                         \
+        (void)op;                                                                                                                                                         \
+        (void)elem_size;                                                                                                                                                  \
+        if (seed) {                                                                                                                                                       \
+            cvector_clib_memcpy(&sum, seed, sizeof(type));                                                                                                                \
+        }                                                                                                                                                                 \
+        if (exclusive) {                                                                                                                                                  \
+            for (i = 0; i < count; ++i) {                                                                                                                                 \
+                const type value = CVECTOR_PARALLEL_LOAD(load, src + i);                                                                                                  \
+                cvector_clib_memcpy(dst + i, &sum, sizeof(type));                                                                                                         \
+                sum += value;                                                                                                                                             \
+            }                                                                                                                                                             \
+        } else {                                                                                                                                                          \
+            for (i = 0; i < count; ++i) {                                                                                                                                 \
+                sum += CVECTOR_PARALLEL_LOAD(load, src + i);                                                                                                              \
+                cvector_clib_memcpy(dst + i, &sum, sizeof(type));                                                                                                         \
+            }                                                                                                                                                             \
+        }                                                                                                                                                                 \
+    }
+
+CVECTOR_PARALLEL_SUM_KERNEL(uchar, unsigned char)
+CVECTOR_PARALLEL_SUM_KERNEL(ushort, unsigned short)
+CVECTOR_PARALLEL_SUM_KERNEL(uint, unsigned int)
+CVECTOR_PARALLEL_SUM_KERNEL(ulong, unsigned long)
+CVECTOR_PARALLEL_SUM_KERNEL(float, float)
+CVECTOR_PARALLEL_SUM_KERNEL(double, double)
+CVECTOR_PARALLEL_SUM_SCAN_KERNEL(uchar, unsigned char)
+CVECTOR_PARALLEL_SUM_SCAN_KERNEL(ushort, unsigned short)
+CVECTOR_PARALLEL_SUM_SCAN_KERNEL(uint, unsigned int)
+CVECTOR_PARALLEL_SUM_SCAN_KERNEL(ulong, unsigned long)
+#ifdef ULLONG_MAX
+CVECTOR_PARALLEL_SUM_KERNEL(ullong, unsigned long long)
+CVECTOR_PARALLEL_SUM_SCAN_KERNEL(ullong, unsigned long long)
+#endif
+
+/* the integer kernels for elements of `elem_size` bytes, or 0 if there are none,
+ * the widest type comes first so that each kernel is reachable */
+static int cvector_parallel_integer_kernels(size_t elem_size, cvector_parallel_reduce_fn *reduce, cvector_parallel_scan_fn *scan) {
+#ifdef ULLONG_MAX
+    if (elem_size == sizeof(unsigned long long)) {
+        *reduce = cvector_parallel_sum_ullong;
+        *scan   = cvector_parallel_sum_scan_ullong;
+        return 1;
+    }
+#endif
+    if (elem_size == sizeof(unsigned long)) {
+        *reduce = cvector_parallel_sum_ulong;
+        *scan   = cvector_parallel_sum_scan_ulong;
+    } else if (elem_size == sizeof(unsigned int)) {
+        *reduce = cvector_parallel_sum_uint;
+        *scan   = cvector_parallel_sum_scan_uint;
+    } else if (elem_size == sizeof(unsigned short)) {
+        *reduce = cvector_parallel_sum_ushort;
+        *scan   = cvector_parallel_sum_scan_ushort;
+    } else if (elem_size == sizeof(unsigned char)) {
+        *reduce = cvector_parallel_sum_uchar;
+        *scan   = cvector_parallel_sum_scan_uchar;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+typedef struct cvector_parallel_scan_arg_t {
+    const char *in;
+    char *out;
+    size_t elem_size;
+    size_t grain;
+    char *partials; /* the partial result of each chunk, then the start of the chunk after it */
+    const void *init;
+    int exclusive;
+    cvector_parallel_reduce_fn reduce;
+    cvector_parallel_scan_fn scan;
+    cvector_parallel_op_fn op;
+} cvector_parallel_scan_arg_t;
+
+/* the first pass, reduces each chunk in [first, last) to its partial result */
+static void cvector_parallel_partial_kernel(void *p, size_t first, size_t last) {
+    const cvector_parallel_scan_arg_t *arg = (const cvector_parallel_scan_arg_t *)p;
+    const size_t elem_size                 = arg->elem_size;
+    while (first < last) {
+        const size_t end = last - first < arg->grain ? last : first + arg->grain;
+        char *partial    = arg->partials + first / arg->grain * elem_size;
+        cvector_clib_memcpy(partial, arg->in + first * elem_size, elem_size);
+        arg->reduce(arg->op, partial, arg->in + (first + 1) * elem_size, end - first - 1, elem_size);
+        first = end;
+    }
+}
+
+/* the second pass, scans each chunk in [first, last) from the start left in `partials` */
+static void cvector_parallel_scan_kernel(void *p, size_t first, size_t last) {
+    const cvector_parallel_scan_arg_t *arg = (const cvector_parallel_scan_arg_t *)p;
+    const size_t elem_size                 = arg->elem_size;
+    while (first < last) {
+        const size_t end   = last - first < arg->grain ? last : first + arg->grain;
+        const size_t chunk = first / arg->grain;
+        const void *seed   = chunk ? arg->partials + (chunk - 1) * elem_size : (arg->exclusive ? arg->init : NULL);
+        arg->scan(arg->op, arg->out + first * elem_size, arg->in + first * elem_size, end - first, elem_size, seed, arg->exclusive);
+        first = end;
+    }
+}
+
+static void cvector_parallel_reduce_run(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc, cvector_parallel_reduce_fn reduce, cvector_parallel_op_fn op) {
+    cvector_parallel_scan_arg_t arg;
+    size_t chunks;
+    size_t i;
+
+    arg.grain = cvector_parallel_grain(elem_size);
+    chunks    = cvector_parallel_chunks(count, arg.grain);
+    pool      = cvector_parallel_select(pool, count, arg.grain);
+    if (!pool || !(arg.partials = (char *)cvector_clib_malloc(chunks * elem_size))) {
+        reduce(op, acc, data, count, elem_size);
+        return;
+    }
+    arg.in        = (const char *)data;
+    arg.elem_size = elem_size;
+    arg.reduce    = reduce;
+    arg.op        = op;
+    cvector_parallel_run(pool, count, arg.grain, cvector_parallel_partial_kernel, &arg);
+    for (i = 0; i < chunks; ++i) {
+        reduce(op, acc, arg.partials + i * elem_size, 1, elem_size);
+    }
+    cvector_clib_free(arg.partials);
+}
+
+static void cvector_parallel_scan_run(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t elem_size, const void *init, cvector_parallel_reduce_fn reduce, cvector_parallel_scan_fn scan, cvector_parallel_op_fn op) {
+    cvector_parallel_scan_arg_t arg;
+    size_t chunks;
+    char *carry;
+    size_t i;
+
+    arg.grain = cvector_parallel_grain(elem_size);
+    chunks    = cvector_parallel_chunks(count, arg.grain);
+    pool      = cvector_parallel_select(pool, count, arg.grain);
+    if (!pool || !(arg.partials = (char *)cvector_clib_malloc(chunks * elem_size))) {
+        scan(op, out, in, count, elem_size, init, init != NULL);
+        return;
+    }
+    arg.in        = (const char *)in;
+    arg.out       = (char *)out;
+    arg.elem_size = elem_size;
+    arg.init      = init;
+    arg.exclusive = init != NULL;
+    arg.reduce    = reduce;
+    arg.scan      = scan;
+    arg.op        = op;
+
+    /* the last chunk's partial is never needed, its slot holds the running combination instead */
+    cvector_parallel_run(pool, (chunks - 1) * arg.grain, arg.grain, cvector_parallel_partial_kernel, &arg);
+    carry = arg.partials + (chunks - 1) * elem_size;
+    if (arg.exclusive) {
+        cvector_clib_memcpy(carry, init, elem_size);
+        i = 0;
+    } else {
+        /* the first partial already is the start of the second chunk */
+        cvector_clib_memcpy(carry, arg.partials, elem_size);
+        i = 1;
+    }
+    for (; i + 1 < chunks; ++i) {
+        reduce(op, carry, arg.partials + i * elem_size, 1, elem_size);
+        cvector_clib_memcpy(arg.partials + i * elem_size, carry, elem_size);
+    }
+    cvector_parallel_run(pool, count, arg.grain, cvector_parallel_scan_kernel, &arg);
+    cvector_clib_free(arg.partials);
+}
+
+void cvector_parallel_reduce_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc, cvector_parallel_op_fn op) {
+    cvector_parallel_reduce_run(pool, data, count, elem_size, acc, cvector_parallel_reduce_op, op);
+}
+
+void cvector_parallel_scan_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t elem_size, const void *init, cvector_parallel_op_fn op) {
+    cvector_parallel_scan_run(pool, in, out, count, elem_size, init, cvector_parallel_reduce_op, cvector_parallel_scan_op, op);
+}
+
+void cvector_parallel_sum_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc) {
+    cvector_parallel_reduce_fn reduce;
+    cvector_parallel_scan_fn scan;
+    if (cvector_parallel_integer_kernels(elem_size, &reduce, &scan)) {
+        cvector_parallel_reduce_run(pool, data, count, elem_size, acc, reduce, NULL);
+    } else {
+        cvector_clib_assert(!"cvector_parallel_sum_n: no integer type of this size");
+    }
+}
+
+void cvector_parallel_fsum_n(cvector_thread_pool_t *pool, const void *data, size_t count, size_t elem_size, void *acc) {
+    if (elem_size == sizeof(double)) {
+        cvector_parallel_reduce_run(pool, data, count, elem_size, acc, cvector_parallel_sum_double, NULL);
+    } else if (elem_size == sizeof(float)) {
+        cvector_parallel_reduce_run(pool, data, count, elem_size, acc, cvector_parallel_sum_float, NULL);
+    } else {
+        cvector_clib_assert(!"cvector_parallel_fsum_n: elements are neither float nor double");
+    }
+}
+
+void cvector_parallel_sum_scan_n(cvector_thread_pool_t *pool, const void *in, void *out, size_t count, size_t elem_size, const void *init) {
+    cvector_parallel_reduce_fn reduce;
+    cvector_parallel_scan_fn scan;
+    if (cvector_parallel_integer_kernels(elem_size, &reduce, &scan)) {
+        cvector_parallel_scan_run(pool, in, out, count, elem_size, init, reduce, scan, NULL);
+    } else {
+        cvector_clib_assert(!"cvector_parallel_sum_scan_n: no integer type of this size");
+    }
+}
+
+#endif /* CVECTOR_PARALLEL_IMPLEMENTATION */
+
+#endif /* CVECTOR_PARALLEL_H_ */
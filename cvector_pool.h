@@ -0,0 +1,209 @@
+#ifndef CVECTOR_POOL_H_
+#define CVECTOR_POOL_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief size class pool allocator for small vectors
+ * @file cvector_pool.h
+ */
+
+/* The pool rounds every block up to a power of two size class, and reports
+ * the class size through good_size_fn so that a growing vector fills the whole
+ * block. Together with the default doubling growth policy, the first few
+ * growth steps of a small vector stay inside the class it started in and cost
+ * nothing at all. Blocks handed back by cvector_free are kept on a per thread
+ * free list and reused by the next vector of the same class, so short lived
+ * small vectors rarely reach the C library allocator.
+ *
+ * Blocks larger than (1 << CVECTOR_POOL_MAX_SHIFT) bytes are passed straight
+ * through to the cvector_clib_* functions.
+ *
+ * The cached blocks of a thread are only released by cvector_pool_trim, call
+ * it before a thread which used the pool exits.
+ *
+ * This header contains declarations only, in exactly one translation unit
+ * define CVECTOR_POOL_IMPLEMENTATION before including it:
+ *
+ * #define CVECTOR_POOL_IMPLEMENTATION
+ * #include "cvector_pool.h"
+ *
+ * ex:
+ *
+ * cvector_vector_type(int) v = NULL;
+ * cvector_init_pooled(v, 0, NULL);
+ * cvector_push_back(v, 42);
+ * cvector_free(v);
+ */
+#include "cvector.h"
+
+/* smallest size class is (1 << CVECTOR_POOL_MIN_SHIFT) bytes */
+#ifndef CVECTOR_POOL_MIN_SHIFT
+#define CVECTOR_POOL_MIN_SHIFT 6
+#endif
+
+/* largest size class is (1 << CVECTOR_POOL_MAX_SHIFT) bytes */
+#ifndef CVECTOR_POOL_MAX_SHIFT
+#define CVECTOR_POOL_MAX_SHIFT 12
+#endif
+
+/* maximum number of free blocks each thread keeps per size class */
+#ifndef CVECTOR_POOL_MAX_CACHED
+#define CVECTOR_POOL_MAX_CACHED 64
+#endif
+
+/* storage class of the per thread free lists */
+#ifndef CVECTOR_THREAD_LOCAL
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define CVECTOR_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define CVECTOR_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define CVECTOR_THREAD_LOCAL __declspec(thread)
+#else
+#error "no thread local storage available, define CVECTOR_THREAD_LOCAL"
+#endif
+#endif
+
+/* the pool allocator, shared by every thread */
+extern const cvector_allocator_t cvector_pool_allocator;
+
+/**
+ * @brief cvector_pool_trim - releases every block cached by the calling thread
+ * @return void
+ */
+void cvector_pool_trim(void);
+
+/**
+ * @brief cvector_pool_good_size - the number of bytes the pool actually provides for a request of `size` bytes
+ * @param size - requested size in bytes
+ * @return the size of the size class, or `size` if it is too large to be pooled
+ */
+size_t cvector_pool_good_size(size_t size);
+
+/**
+ * @brief cvector_init_pooled - Initialize a vector whose storage comes from the pool.
+ * The vector must be NULL for this to do anything.
+ * @param vec - the vector
+ * @param capacity - vector capacity to reserve
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_init_pooled(vec, capacity, elem_destructor_fn) \
+    cvector_init_with_allocator((vec), (capacity), (elem_destructor_fn), &cvector_pool_allocator)
+
+#ifdef CVECTOR_POOL_IMPLEMENTATION
+
+#define CVECTOR_POOL_CLASSES (CVECTOR_POOL_MAX_SHIFT - CVECTOR_POOL_MIN_SHIFT + 1)
+
+/* a cached block stores the link to the next one in its first bytes */
+typedef struct cvector_pool_node_t {
+    struct cvector_pool_node_t *next;
+} cvector_pool_node_t;
+
+typedef struct cvector_pool_cache_t {
+    cvector_pool_node_t *head[CVECTOR_POOL_CLASSES];
+    size_t count[CVECTOR_POOL_CLASSES];
+} cvector_pool_cache_t;
+
+static CVECTOR_THREAD_LOCAL cvector_pool_cache_t cvector_pool_cache;
+
+/* returns the size class of `size`, or -1 if it is too large to be pooled */
+static int cvector_pool_class(size_t size) {
+    int index = 0;
+    while (((size_t)1 << (CVECTOR_POOL_MIN_SHIFT + index)) < size) {
+        if (++index == CVECTOR_POOL_CLASSES) {
+            return -1;
+        }
+    }
+    return index;
+}
+
+static void *cvector_pool_malloc_fn(void *ctx, size_t size) {
+    const int index = cvector_pool_class(size);
+    (void)ctx;
+
+    if (index < 0) {
+        return cvector_clib_malloc(size);
+    }
+
+    if (cvector_pool_cache.head[index]) {
+        cvector_pool_node_t *node        = cvector_pool_cache.head[index];
+        cvector_pool_cache.head[index]   = node->next;
+        cvector_pool_cache.count[index] -= 1;
+        return node;
+    }
+
+    return cvector_clib_malloc((size_t)1 << (CVECTOR_POOL_MIN_SHIFT + index));
+}
+
+static void cvector_pool_free_fn(void *ctx, void *ptr, size_t size) {
+    const int index = cvector_pool_class(size);
+    (void)ctx;
+
+    if (index < 0 || cvector_pool_cache.count[index] == CVECTOR_POOL_MAX_CACHED) {
+        cvector_clib_free(ptr);
+        return;
+    }
+
+    ((cvector_pool_node_t *)ptr)->next = cvector_pool_cache.head[index];
+    cvector_pool_cache.head[index]     = (cvector_pool_node_t *)ptr;
+    cvector_pool_cache.count[index]   += 1;
+}
+
+static void *cvector_pool_realloc_fn(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    const int old_index = cvector_pool_class(old_size);
+    const int new_index = cvector_pool_class(new_size);
+    void *p;
+
+    if (old_index < 0 && new_index < 0) {
+        return cvector_clib_realloc(ptr, new_size);
+    }
+
+    /* the block is already large enough (or not worth shrinking) */
+    if (old_index == new_index) {
+        return ptr;
+    }
+
+    p = cvector_pool_malloc_fn(ctx, new_size);
+    if (p) {
+        cvector_clib_memcpy(p, ptr, old_size < new_size ? old_size : new_size);
+        cvector_pool_free_fn(ctx, ptr, old_size);
+    }
+    return p;
+}
+
+size_t cvector_pool_good_size(size_t size) {
+    const int index = cvector_pool_class(size);
+    return index < 0 ? size : (size_t)1 << (CVECTOR_POOL_MIN_SHIFT + index);
+}
+
+static size_t cvector_pool_good_size_fn(void *ctx, size_t size) {
+    (void)ctx;
+    return cvector_pool_good_size(size);
+}
+
+const cvector_allocator_t cvector_pool_allocator = {
+    cvector_pool_malloc_fn,
+    cvector_pool_realloc_fn,
+    cvector_pool_free_fn,
+    NULL,
+    cvector_pool_good_size_fn,
+};
+
+void cvector_pool_trim(void) {
+    int index;
+    for (index = 0; index < CVECTOR_POOL_CLASSES; ++index) {
+        cvector_pool_node_t *node = cvector_pool_cache.head[index];
+        while (node) {
+            cvector_pool_node_t *next = node->next;
+            cvector_clib_free(node);
+            node = next;
+        }
+        cvector_pool_cache.head[index]  = NULL;
+        cvector_pool_cache.count[index] = 0;
+    }
+}
+
+#endif /* CVECTOR_POOL_IMPLEMENTATION */
+
+#endif /* CVECTOR_POOL_H_ */
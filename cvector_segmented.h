@@ -0,0 +1,224 @@
+#ifndef CVECTOR_SEGMENTED_H_
+#define CVECTOR_SEGMENTED_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief segmented vectors, which grow without moving their elements
+ * @file cvector_segmented.h
+ */
+
+/* A segmented vector is a directory of blocks of CVECTOR_SEGMENT_BYTES bytes
+ * each. The directory is a regular vector of pointers and every block is a
+ * regular vector of elements whose capacity never changes, so:
+ *
+ * - growing allocates one new block and never copies or moves an element,
+ *   pointers to elements stay valid until the element is removed
+ * - the peak memory while growing is the elements plus at most one partially
+ *   filled block and the directory, instead of up to 3x the elements while
+ *   cvector_grow copies to a new block
+ * - indexing costs one extra load (the block pointer) compared to a vector
+ *
+ * Every block but the last one is full, and a segmented vector which is not
+ * NULL always has at least one block. The blocks can be used like any other
+ * vector to iterate over the elements quickly:
+ *
+ * cvector_segmented_type(int) s = NULL;
+ * size_t b;
+ * int *it;
+ * cvector_segmented_push_back(s, 1);
+ * for (b = 0; b < cvector_segmented_block_count(s); ++b) {
+ *     for (it = cvector_begin(s[b]); it != cvector_end(s[b]); ++it) { ... }
+ * }
+ * cvector_segmented_free(s);
+ */
+#include "cvector.h"
+
+/* size of one block, blocks of elements larger than this hold a single element */
+#ifndef CVECTOR_SEGMENT_BYTES
+#define CVECTOR_SEGMENT_BYTES 65536
+#endif
+
+/**
+ * @brief cvector_segmented_type - The segmented vector type used in this library
+ * @param type The type of segmented vector to act on.
+ */
+#define cvector_segmented_type(type) cvector_vector_type(type *)
+
+/**
+ * @brief cvector_segment_length - For internal use, the number of elements in one block
+ * @param seg - the segmented vector
+ * @return as a size_t
+ * @internal
+ */
+#define cvector_segment_length(seg) \
+    (sizeof(**(seg)) < CVECTOR_SEGMENT_BYTES ? CVECTOR_SEGMENT_BYTES / sizeof(**(seg)) : (size_t)1)
+
+/**
+ * @brief cvector_segmented_init - Initialize a segmented vector. The directory and the first block are allocated.
+ * @param seg - the segmented vector
+ * @param elem_destructor_fn - element destructor function
+ * @return void
+ */
+#define cvector_segmented_init(seg, elem_destructor_fn)                                \
+    do {                                                                               \
+        if (!(seg)) {                                                                  \
+            cvector_init((seg), 1, NULL);                                              \
+            cvector_push_back((seg), NULL);                                            \
+            cvector_init((seg)[0], cvector_segment_length(seg), (elem_destructor_fn)); \
+        }                                                                              \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_block_count - gets the number of blocks, block `i` is the vector `seg[i]`
+ * @param seg - the segmented vector
+ * @return the number of blocks as a size_t
+ */
+#define cvector_segmented_block_count(seg) cvector_size(seg)
+
+/**
+ * @brief cvector_segmented_size - gets the current size of the segmented vector
+ * @param seg - the segmented vector
+ * @return the size as a size_t
+ */
+#define cvector_segmented_size(seg)                                                                             \
+    ((seg) ? (cvector_size(seg) - 1) * cvector_segment_length(seg) + cvector_size((seg)[cvector_size(seg) - 1]) \
+           : (size_t)0)
+
+/**
+ * @brief cvector_segmented_capacity - gets the number of elements the segmented vector holds without allocating a block
+ * @param seg - the segmented vector
+ * @return the capacity as a size_t
+ */
+#define cvector_segmented_capacity(seg) \
+    (cvector_size(seg) * cvector_segment_length(seg))
+
+/**
+ * @brief cvector_segmented_empty - returns non-zero if the segmented vector is empty
+ * @param seg - the segmented vector
+ * @return non-zero if empty, zero if non-empty
+ */
+#define cvector_segmented_empty(seg) \
+    (cvector_segmented_size(seg) == 0)
+
+/**
+ * @brief cvector_segmented_at - returns a pointer to the element at position n
+ * @param seg - the segmented vector
+ * @param n - the position of the element
+ * @return a pointer to the element, or NULL if n is out of range
+ */
+#define cvector_segmented_at(seg, n)                                                                    \
+    ((size_t)(n) < cvector_segmented_size(seg)                                                          \
+         ? &(seg)[(size_t)(n) / cvector_segment_length(seg)][(size_t)(n) % cvector_segment_length(seg)] \
+         : NULL)
+
+/**
+ * @brief cvector_segmented_back - returns a pointer to the last element
+ * @param seg - the segmented vector
+ * @return a pointer to the last element, or NULL if the segmented vector is empty
+ */
+#define cvector_segmented_back(seg) \
+    (cvector_segmented_empty(seg) ? NULL : cvector_segmented_at((seg), cvector_segmented_size(seg) - 1))
+
+/**
+ * @brief cvector_segmented_add_block - For internal use, appends an empty block to the directory
+ * @param seg - the segmented vector
+ * @return void
+ * @internal
+ */
+#define cvector_segmented_add_block(seg)                                                                        \
+    do {                                                                                                        \
+        cvector_elem_destructor_t cv_segmented_add_block_dtor__ = cvector_elem_destructor((seg)[0]);            \
+        cvector_push_back((seg), NULL);                                                                         \
+        cvector_init((seg)[cvector_size(seg) - 1], cvector_segment_length(seg), cv_segmented_add_block_dtor__); \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_push_back - adds an element to the end of the segmented vector
+ * @param seg - the segmented vector
+ * @param value - the value to add
+ * @return void
+ */
+#define cvector_segmented_push_back(seg, value)                                                  \
+    do {                                                                                         \
+        size_t cv_segmented_push_back_last__;                                                    \
+        cvector_segmented_init((seg), NULL);                                                     \
+        cv_segmented_push_back_last__ = cvector_size(seg) - 1;                                   \
+        if (cvector_size((seg)[cv_segmented_push_back_last__]) == cvector_segment_length(seg)) { \
+            cvector_segmented_add_block(seg);                                                    \
+            ++cv_segmented_push_back_last__;                                                     \
+        }                                                                                        \
+        cvector_push_back((seg)[cv_segmented_push_back_last__], (value));                        \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_pop_back - removes the last element from the segmented vector, if there is one
+ * @param seg - the segmented vector
+ * @return void
+ */
+#define cvector_segmented_pop_back(seg)                                                                   \
+    do {                                                                                                  \
+        if (!cvector_segmented_empty(seg)) {                                                              \
+            size_t cv_segmented_pop_back_last__ = cvector_size(seg) - 1;                                  \
+            /* an empty last block is kept until the element before it is popped */                       \
+            if (cv_segmented_pop_back_last__ > 0 && cvector_empty((seg)[cv_segmented_pop_back_last__])) { \
+                cvector_free((seg)[cv_segmented_pop_back_last__]);                                        \
+                cvector_set_size((seg), cv_segmented_pop_back_last__);                                    \
+                --cv_segmented_pop_back_last__;                                                           \
+            }                                                                                             \
+            cvector_pop_back((seg)[cv_segmented_pop_back_last__]);                                        \
+        }                                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_clear - erases all of the elements and releases all blocks but the first
+ * @param seg - the segmented vector
+ * @return void
+ */
+#define cvector_segmented_clear(seg)                                                                                 \
+    do {                                                                                                             \
+        if (seg) {                                                                                                   \
+            size_t cv_segmented_clear_i__;                                                                           \
+            for (cv_segmented_clear_i__ = 1; cv_segmented_clear_i__ < cvector_size(seg); ++cv_segmented_clear_i__) { \
+                cvector_free((seg)[cv_segmented_clear_i__]);                                                         \
+            }                                                                                                        \
+            cvector_set_size((seg), 1);                                                                              \
+            cvector_clear((seg)[0]);                                                                                 \
+        }                                                                                                            \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_free - frees all memory associated with the segmented vector
+ * @param seg - the segmented vector
+ * @return void
+ */
+#define cvector_segmented_free(seg)                                                                               \
+    do {                                                                                                          \
+        if (seg) {                                                                                                \
+            size_t cv_segmented_free_i__;                                                                         \
+            for (cv_segmented_free_i__ = 0; cv_segmented_free_i__ < cvector_size(seg); ++cv_segmented_free_i__) { \
+                cvector_free((seg)[cv_segmented_free_i__]);                                                       \
+            }                                                                                                     \
+            cvector_free(seg);                                                                                    \
+        }                                                                                                         \
+    } while (0)
+
+/**
+ * @brief cvector_segmented_for_each - call function func on each element of the segmented vector
+ * @param seg - the segmented vector
+ * @param func - function to be called on each element that takes each element as argument
+ * @return void
+ */
+#define cvector_segmented_for_each(seg, func)                                                                                                                  \
+    do {                                                                                                                                                       \
+        if ((seg) && (func) != NULL) {                                                                                                                         \
+            size_t cv_segmented_for_each_b__;                                                                                                                  \
+            size_t cv_segmented_for_each_i__;                                                                                                                  \
+            for (cv_segmented_for_each_b__ = 0; cv_segmented_for_each_b__ < cvector_size(seg); ++cv_segmented_for_each_b__) {                                  \
+                for (cv_segmented_for_each_i__ = 0; cv_segmented_for_each_i__ < cvector_size((seg)[cv_segmented_for_each_b__]); ++cv_segmented_for_each_i__) { \
+                    func((seg)[cv_segmented_for_each_b__][cv_segmented_for_each_i__]);                                                                         \
+                }                                                                                                                                              \
+            }                                                                                                                                                  \
+        }                                                                                                                                                      \
+    } while (0)
+
+#endif /* CVECTOR_SEGMENTED_H_ */
@@ -0,0 +1,245 @@
+#ifndef CVECTOR_SPSC_H_
+#define CVECTOR_SPSC_H_
+/**
+ * @copyright Copyright (c) 2015 Evan Teran,
+ * License: The MIT License (MIT)
+ * @brief bounded lock-free single-producer/single-consumer queues
+ * @file cvector_spsc.h
+ */
+
+/* A SPSC queue passes elements from exactly one producer thread to exactly one
+ * consumer thread without locks. Like a vector, the queue is a pointer to its
+ * elements with the meta-data in front of them, so the element type comes from
+ * the pointer:
+ *
+ * cvector_spsc_type(struct record) q = NULL;
+ * cvector_spsc_init(q, 1024);           (before the threads start)
+ *
+ * producer: cvector_spsc_push(q, record, ok);  or cvector_spsc_push_n(q, records, n, pushed);
+ * consumer: cvector_spsc_pop(q, record, ok);   or cvector_spsc_pop_n(q, records, n, popped);
+ *
+ * cvector_spsc_free(q);                 (after both threads are done)
+ *
+ * The head index is only written by the consumer and the tail index only by
+ * the producer, and each lives on its own cache line together with that
+ * thread's cached copy of the other index. A thread only reads the other
+ * side's cache line when its cached copy says the queue is full (or empty),
+ * so in steady state the two threads do not bounce cache lines between them.
+ * The indices count up forever and are masked into the storage, whose
+ * capacity is a power of two. Elements are copied in and out with plain
+ * assignment (or memcpy for the _n versions), there are no destructors.
+ */
+#include "cvector.h"
+#include "cvector_atomic.h"
+
+typedef struct cvector_spsc_metadata_t {
+    /* written by the consumer */
+    cvector_atomic_size_t head;
+    size_t cached_tail;
+    char pad0[CVECTOR_CACHE_LINE - sizeof(cvector_atomic_size_t) - sizeof(size_t)];
+
+    /* written by the producer */
+    cvector_atomic_size_t tail;
+    size_t cached_head;
+    char pad1[CVECTOR_CACHE_LINE - sizeof(cvector_atomic_size_t) - sizeof(size_t)];
+
+    /* constant after cvector_spsc_init */
+    size_t capacity;
+    size_t mask;
+    size_t offset;
+    char pad2[CVECTOR_CACHE_LINE - 3 * sizeof(size_t)];
+} cvector_spsc_metadata_t;
+
+/**
+ * @brief cvector_spsc_type - The SPSC queue type used in this library
+ * @param type The type of queue to act on.
+ */
+#define cvector_spsc_type(type) cvector_vector_type(type)
+
+/**
+ * @brief cvector_spsc_vec_to_meta - For internal use, converts a queue pointer to a metadata pointer
+ * @param q - the queue
+ * @return the metadata pointer
+ * @internal
+ */
+#define cvector_spsc_vec_to_meta(q) \
+    (&((cvector_spsc_metadata_t *)(void *)(q))[-1])
+
+/**
+ * @brief cvector_spsc_init - Initialize a queue, before it is shared between threads. The queue must be NULL for this to do anything.
+ * @param q - the queue
+ * @param min_capacity - the minimum number of elements the queue holds, rounded up to a power of two which must fit in memory
+ * @return void
+ */
+#define cvector_spsc_init(q, min_capacity)                                                                                                                \
+    do {                                                                                                                                                  \
+        if (!(q)) {                                                                                                                                       \
+            size_t cv_spsc_init_cap__ = 1;                                                                                                                \
+            char *cv_spsc_init_p__;                                                                                                                       \
+            size_t cv_spsc_init_off__;                                                                                                                    \
+            cvector_spsc_metadata_t *cv_spsc_init_m__;                                                                                                    \
+            while (cv_spsc_init_cap__ < (size_t)(min_capacity)) {                                                                                         \
+                /* stops before the size overflows, such a queue could never be allocated */                                                              \
+                cvector_clib_assert(cv_spsc_init_cap__ <= ((size_t)-1 - sizeof(cvector_spsc_metadata_t) - CVECTOR_CACHE_LINE) / 2 / sizeof(*(q)));        \
+                cv_spsc_init_cap__ <<= 1;                                                                                                                 \
+            }                                                                                                                                             \
+            cv_spsc_init_p__ = (char *)cvector_clib_malloc(sizeof(cvector_spsc_metadata_t) + cv_spsc_init_cap__ * sizeof(*(q)) + CVECTOR_CACHE_LINE - 1); \
+            cvector_clib_assert(cv_spsc_init_p__);                                                                                                        \
+            cv_spsc_init_off__ = ((size_t)0 - (size_t)cv_spsc_init_p__) & (CVECTOR_CACHE_LINE - 1);                                                       \
+            cv_spsc_init_m__   = (cvector_spsc_metadata_t *)(void *)(cv_spsc_init_p__ + cv_spsc_init_off__);                                              \
+            cvector_atomic_init(&cv_spsc_init_m__->head, 0);                                                                                              \
+            cvector_atomic_init(&cv_spsc_init_m__->tail, 0);                                                                                              \
+            cv_spsc_init_m__->cached_tail = 0;                                                                                                            \
+            cv_spsc_init_m__->cached_head = 0;                                                                                                            \
+            cv_spsc_init_m__->capacity    = cv_spsc_init_cap__;                                                                                           \
+            cv_spsc_init_m__->mask        = cv_spsc_init_cap__ - 1;                                                                                       \
+            cv_spsc_init_m__->offset      = cv_spsc_init_off__;                                                                                           \
+            (q)                           = (void *)(cv_spsc_init_m__ + 1);                                                                               \
+        }                                                                                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_spsc_free - frees all memory associated with the queue, once neither thread uses it
+ * @param q - the queue
+ * @return void
+ */
+#define cvector_spsc_free(q)                                                                              \
+    do {                                                                                                  \
+        if (q) {                                                                                          \
+            cvector_clib_free((char *)cvector_spsc_vec_to_meta(q) - cvector_spsc_vec_to_meta(q)->offset); \
+        }                                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_spsc_capacity - gets the number of elements the queue holds
+ * @param q - the queue
+ * @return the capacity as a size_t
+ */
+#define cvector_spsc_capacity(q) \
+    ((q) ? cvector_spsc_vec_to_meta(q)->capacity : (size_t)0)
+
+/**
+ * @brief cvector_spsc_size - gets the number of elements in the queue. Unless both threads are stopped this is only a snapshot.
+ * @param q - the queue
+ * @return the size as a size_t
+ */
+#define cvector_spsc_size(q)                                                   \
+    ((q) ? cvector_atomic_load_acquire(&cvector_spsc_vec_to_meta(q)->tail) -   \
+               cvector_atomic_load_acquire(&cvector_spsc_vec_to_meta(q)->head) \
+         : (size_t)0)
+
+/**
+ * @brief cvector_spsc_push - called by the producer, appends `value` to the queue unless it is full
+ * @param q - the queue
+ * @param value - the value to add
+ * @param ok - set to 1 if the value was added, 0 if the queue was full
+ * @return void
+ */
+#define cvector_spsc_push(q, value, ok)                                                                   \
+    do {                                                                                                  \
+        cvector_spsc_metadata_t *cv_spsc_push_m__ = cvector_spsc_vec_to_meta(q);                          \
+        const size_t cv_spsc_push_tail__          = cvector_atomic_load_relaxed(&cv_spsc_push_m__->tail); \
+        if (cv_spsc_push_tail__ - cv_spsc_push_m__->cached_head == cv_spsc_push_m__->capacity) {          \
+            cv_spsc_push_m__->cached_head = cvector_atomic_load_acquire(&cv_spsc_push_m__->head);         \
+        }                                                                                                 \
+        if (cv_spsc_push_tail__ - cv_spsc_push_m__->cached_head != cv_spsc_push_m__->capacity) {          \
+            (q)[cv_spsc_push_tail__ & cv_spsc_push_m__->mask] = (value);                                  \
+            cvector_atomic_store_release(&cv_spsc_push_m__->tail, cv_spsc_push_tail__ + 1);               \
+            (ok) = 1;                                                                                     \
+        } else {                                                                                          \
+            (ok) = 0;                                                                                     \
+        }                                                                                                 \
+    } while (0)
+
+/**
+ * @brief cvector_spsc_pop - called by the consumer, removes the first element of the queue unless it is empty
+ * @param q - the queue
+ * @param out - the variable which receives the element
+ * @param ok - set to 1 if an element was removed, 0 if the queue was empty
+ * @return void
+ */
+#define cvector_spsc_pop(q, out, ok)                                                                    \
+    do {                                                                                                \
+        cvector_spsc_metadata_t *cv_spsc_pop_m__ = cvector_spsc_vec_to_meta(q);                         \
+        const size_t cv_spsc_pop_head__          = cvector_atomic_load_relaxed(&cv_spsc_pop_m__->head); \
+        if (cv_spsc_pop_head__ == cv_spsc_pop_m__->cached_tail) {                                       \
+            cv_spsc_pop_m__->cached_tail = cvector_atomic_load_acquire(&cv_spsc_pop_m__->tail);         \
+        }                                                                                               \
+        if (cv_spsc_pop_head__ != cv_spsc_pop_m__->cached_tail) {                                       \
+            (out) = (q)[cv_spsc_pop_head__ & cv_spsc_pop_m__->mask];                                    \
+            cvector_atomic_store_release(&cv_spsc_pop_m__->head, cv_spsc_pop_head__ + 1);               \
+            (ok) = 1;                                                                                   \
+        } else {                                                                                        \
+            (ok) = 0;                                                                                   \
+        }                                                                                               \
+    } while (0)
+
+/**
+ * @brief cvector_spsc_push_n - called by the producer, appends as many of the `n` elements at `src` as fit
+ * @param q - the queue
+ * @param src - pointer to the elements
+ * @param n - the number of elements
+ * @param pushed - set to the number of elements added, from the front of `src`
+ * @return void
+ */
+#define cvector_spsc_push_n(q, src, n, pushed)                                                                                                  \
+    do {                                                                                                                                        \
+        cvector_spsc_metadata_t *cv_spsc_push_n_m__ = cvector_spsc_vec_to_meta(q);                                                              \
+        const size_t cv_spsc_push_n_tail__          = cvector_atomic_load_relaxed(&cv_spsc_push_n_m__->tail);                                   \
+        const size_t cv_spsc_push_n_want__          = (size_t)(n);                                                                              \
+        const size_t cv_spsc_push_n_pos__           = cv_spsc_push_n_tail__ & cv_spsc_push_n_m__->mask;                                         \
+        size_t cv_spsc_push_n_count__               = cv_spsc_push_n_m__->capacity - (cv_spsc_push_n_tail__ - cv_spsc_push_n_m__->cached_head); \
+        size_t cv_spsc_push_n_first__;                                                                                                          \
+        if (cv_spsc_push_n_count__ < cv_spsc_push_n_want__) {                                                                                   \
+            cv_spsc_push_n_m__->cached_head = cvector_atomic_load_acquire(&cv_spsc_push_n_m__->head);                                           \
+            cv_spsc_push_n_count__          = cv_spsc_push_n_m__->capacity - (cv_spsc_push_n_tail__ - cv_spsc_push_n_m__->cached_head);         \
+        }                                                                                                                                       \
+        if (cv_spsc_push_n_count__ > cv_spsc_push_n_want__) {                                                                                   \
+            cv_spsc_push_n_count__ = cv_spsc_push_n_want__;                                                                                     \
+        }                                                                                                                                       \
+        /* at most two copies, the second one after the storage wraps */                                                                        \
+        cv_spsc_push_n_first__ = cv_spsc_push_n_m__->capacity - cv_spsc_push_n_pos__;                                                           \
+        if (cv_spsc_push_n_first__ > cv_spsc_push_n_count__) {                                                                                  \
+            cv_spsc_push_n_first__ = cv_spsc_push_n_count__;                                                                                    \
+        }                                                                                                                                       \
+        cvector_clib_memcpy((q) + cv_spsc_push_n_pos__, (src), cv_spsc_push_n_first__ * sizeof(*(q)));                                          \
+        cvector_clib_memcpy((q), (src) + cv_spsc_push_n_first__, (cv_spsc_push_n_count__ - cv_spsc_push_n_first__) * sizeof(*(q)));             \
+        cvector_atomic_store_release(&cv_spsc_push_n_m__->tail, cv_spsc_push_n_tail__ + cv_spsc_push_n_count__);                                \
+        (pushed) = cv_spsc_push_n_count__;                                                                                                      \
+    } while (0)
+
+/**
+ * @brief cvector_spsc_pop_n - called by the consumer, removes up to `n` elements from the front of the queue
+ * @param q - the queue
+ * @param dst - pointer to room for `n` elements
+ * @param n - the maximum number of elements
+ * @param popped - set to the number of elements removed and stored at the front of `dst`
+ * @return void
+ */
+#define cvector_spsc_pop_n(q, dst, n, popped)                                                                                    \
+    do {                                                                                                                         \
+        cvector_spsc_metadata_t *cv_spsc_pop_n_m__ = cvector_spsc_vec_to_meta(q);                                                \
+        const size_t cv_spsc_pop_n_head__          = cvector_atomic_load_relaxed(&cv_spsc_pop_n_m__->head);                      \
+        const size_t cv_spsc_pop_n_want__          = (size_t)(n);                                                                \
+        const size_t cv_spsc_pop_n_pos__           = cv_spsc_pop_n_head__ & cv_spsc_pop_n_m__->mask;                             \
+        size_t cv_spsc_pop_n_count__               = cv_spsc_pop_n_m__->cached_tail - cv_spsc_pop_n_head__;                      \
+        size_t cv_spsc_pop_n_first__;                                                                                            \
+        if (cv_spsc_pop_n_count__ < cv_spsc_pop_n_want__) {                                                                      \
+            cv_spsc_pop_n_m__->cached_tail = cvector_atomic_load_acquire(&cv_spsc_pop_n_m__->tail);                              \
+            cv_spsc_pop_n_count__          = cv_spsc_pop_n_m__->cached_tail - cv_spsc_pop_n_head__;                              \
+        }                                                                                                                        \
+        if (cv_spsc_pop_n_count__ > cv_spsc_pop_n_want__) {                                                                      \
+            cv_spsc_pop_n_count__ = cv_spsc_pop_n_want__;                                                                        \
+        }                                                                                                                        \
+        /* at most two copies, the second one after the storage wraps */                                                         \
+        cv_spsc_pop_n_first__ = cv_spsc_pop_n_m__->capacity - cv_spsc_pop_n_pos__;                                               \
+        if (cv_spsc_pop_n_first__ > cv_spsc_pop_n_count__) {                                                                     \
+            cv_spsc_pop_n_first__ = cv_spsc_pop_n_count__;                                                                       \
+        }                                                                                                                        \
+        cvector_clib_memcpy((dst), (q) + cv_spsc_pop_n_pos__, cv_spsc_pop_n_first__ * sizeof(*(q)));                             \
+        cvector_clib_memcpy((dst) + cv_spsc_pop_n_first__, (q), (cv_spsc_pop_n_count__ - cv_spsc_pop_n_first__) * sizeof(*(q))); \
+        cvector_atomic_store_release(&cv_spsc_pop_n_m__->head, cv_spsc_pop_n_head__ + cv_spsc_pop_n_count__);                    \
+        (popped) = cv_spsc_pop_n_count__;                                                                                        \
+    } while (0)
+
+#endif /* CVECTOR_SPSC_H_ */
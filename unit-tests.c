@@ -1,8 +1,25 @@
 
 
+#define _GNU_SOURCE /* for mremap */
+#define CVECTOR_ARENA_IMPLEMENTATION
+#define CVECTOR_FILE_IMPLEMENTATION
+#define CVECTOR_MMAP_IMPLEMENTATION
+#define CVECTOR_PARALLEL_IMPLEMENTATION
+#define CVECTOR_POOL_IMPLEMENTATION
 #include "cvector.h"
+#include "cvector_arena.h"
+#include "cvector_concurrent.h"
+#include "cvector_deque.h"
+#include "cvector_file.h"
+#include "cvector_mmap.h"
+#include "cvector_parallel.h"
+#include "cvector_pool.h"
+#include "cvector_segmented.h"
+#include "cvector_spsc.h"
 #include "cvector_utils.h"
 #include "utest/utest.h"
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdlib.h>
 
@@ -399,4 +416,1425 @@ UTEST(test, derefence_destructor) {
     cvector_free(*vec_ptr);
 }
 
+struct counting_allocator_t {
+    size_t mallocs;
+    size_t reallocs;
+    size_t frees;
+    size_t live_bytes;
+};
+
+static void *counting_malloc(void *ctx, size_t size) {
+    struct counting_allocator_t *counts = ctx;
+    counts->mallocs++;
+    counts->live_bytes += size;
+    return malloc(size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    struct counting_allocator_t *counts = ctx;
+    counts->reallocs++;
+    counts->live_bytes += new_size;
+    counts->live_bytes -= old_size;
+    return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr, size_t size) {
+    struct counting_allocator_t *counts = ctx;
+    counts->frees++;
+    counts->live_bytes -= size;
+    free(ptr);
+}
+
+UTEST(test, vector_allocator) {
+    int i;
+    struct counting_allocator_t counts = {0, 0, 0, 0};
+    cvector_allocator_t alloc          = {counting_malloc, counting_realloc, counting_free, NULL, NULL};
+    cvector_vector_type(int) v         = NULL;
+    cvector_vector_type(int) w         = NULL;
+    alloc.ctx                          = &counts;
+
+    cvector_init_with_allocator(v, 0, NULL, &alloc);
+    ASSERT_TRUE(v != NULL);
+    ASSERT_TRUE(cvector_allocator(v) == &alloc);
+    ASSERT_EQ(cvector_capacity(v), (size_t)0);
+    ASSERT_EQ(counts.mallocs, (size_t)1);
+
+    for (i = 0; i < 10; ++i) {
+        cvector_push_back(v, i);
+    }
+    ASSERT_EQ(cvector_size(v), (size_t)10);
+    ASSERT_TRUE(counts.reallocs > 0);
+    ASSERT_EQ(counts.live_bytes, cvector_capacity(v) * sizeof(int) + sizeof(cvector_metadata_t) + sizeof(const cvector_allocator_t *));
+
+    cvector_shrink_to_fit(v);
+    ASSERT_EQ(counts.live_bytes, 10 * sizeof(int) + sizeof(cvector_metadata_t) + sizeof(const cvector_allocator_t *));
+    for (i = 0; i < 10; ++i) {
+        ASSERT_EQ(v[i], i);
+    }
+
+    /* vectors without an allocator keep using the cvector_clib_* functions, and do not store one */
+    cvector_push_back(w, 1);
+    ASSERT_TRUE(cvector_allocator(w) == NULL);
+    ASSERT_TRUE(cvector_vec_to_block(w) == (void *)cvector_vec_to_base(w));
+    ASSERT_EQ(sizeof(cvector_metadata_t), 3 * sizeof(size_t) + sizeof(cvector_elem_destructor_t));
+    cvector_free(w);
+
+    cvector_free(v);
+    ASSERT_EQ(counts.mallocs, (size_t)1);
+    ASSERT_EQ(counts.frees, (size_t)1);
+    ASSERT_EQ(counts.live_bytes, (size_t)0);
+}
+
+UTEST(test, vector_arena) {
+    int i;
+    int *first;
+    cvector_arena_t arena;
+    cvector_vector_type(int) a = NULL;
+    cvector_vector_type(int) b = NULL;
+
+    cvector_arena_init(&arena, 1024);
+    cvector_init_in_arena(a, 4, NULL, &arena);
+    ASSERT_TRUE(cvector_allocator(a) == &arena.allocator);
+
+    /* the most recent allocation grows in place */
+    first = a;
+    for (i = 0; i < 100; ++i) {
+        cvector_push_back(a, i);
+    }
+    ASSERT_TRUE(a == first);
+
+    /* growing an older vector moves it to the end of the arena */
+    cvector_init_in_arena(b, 1, NULL, &arena);
+    cvector_push_back(b, -1);
+    for (i = 100; i < 300; ++i) {
+        cvector_push_back(a, i);
+    }
+    ASSERT_TRUE(a != first);
+    ASSERT_EQ(cvector_size(a), (size_t)300);
+    for (i = 0; i < 300; ++i) {
+        ASSERT_EQ(a[i], i);
+    }
+    ASSERT_EQ(b[0], -1);
+
+    /* drop everything, vectors are not freed individually */
+    cvector_arena_reset(&arena);
+    a = NULL;
+    b = NULL;
+
+    cvector_init_in_arena(a, 8, NULL, &arena);
+    cvector_push_back(a, 7);
+    ASSERT_EQ(a[0], 7);
+    cvector_free(a);
+
+    cvector_arena_destroy(&arena);
+}
+
+UTEST(test, vector_pool) {
+    int i;
+    int *first;
+    cvector_vector_type(int) a = NULL;
+    cvector_vector_type(int) b = NULL;
+
+    cvector_init_pooled(a, 1, NULL);
+    ASSERT_TRUE(cvector_allocator(a) == &cvector_pool_allocator);
+    ASSERT_TRUE(cvector_block_size(a, 4) <= ((size_t)1 << CVECTOR_POOL_MIN_SHIFT));
+
+    /* the early growth steps stay inside the first size class */
+    first = a;
+    for (i = 0; i < 4; ++i) {
+        cvector_push_back(a, i);
+    }
+    ASSERT_TRUE(a == first);
+    ASSERT_EQ(cvector_pool_good_size(cvector_block_size(a, 1)), ((size_t)1 << CVECTOR_POOL_MIN_SHIFT));
+
+    for (i = 4; i < 1000; ++i) {
+        cvector_push_back(a, i);
+    }
+    for (i = 0; i < 1000; ++i) {
+        ASSERT_EQ(a[i], i);
+    }
+    cvector_free(a);
+    a = NULL;
+
+    /* a freed block is handed to the next vector of the same size class */
+    cvector_init_pooled(a, 4, NULL);
+    first = a;
+    cvector_free(a);
+    cvector_init_pooled(b, 4, NULL);
+    ASSERT_TRUE(b == first);
+    cvector_free(b);
+
+    cvector_pool_trim();
+}
+
+struct inline_wide {
+    double value;
+} __attribute__((aligned(64)));
+
+UTEST(test, vector_inline) {
+    int i;
+    cvector_inline_storage(int, 4) storage;
+    cvector_inline_storage(char *, 2) str_storage;
+    cvector_inline_storage(struct inline_wide, 2) wide_storage;
+    cvector_vector_type(int) v                   = NULL;
+    cvector_vector_type(char *) str_v            = NULL;
+    cvector_vector_type(struct inline_wide) wide = NULL;
+    struct inline_wide w;
+
+    cvector_init_inline(v, storage, NULL);
+    ASSERT_EQ(cvector_capacity(v), (size_t)4);
+    ASSERT_FALSE(cvector_owns_storage(v));
+
+    for (i = 0; i < 4; ++i) {
+        cvector_push_back(v, i);
+    }
+    ASSERT_TRUE((void *)v == (void *)(storage.bytes + sizeof(cvector_metadata_t)));
+    ASSERT_FALSE(cvector_owns_storage(v));
+
+    /* shrinking keeps the caller's storage */
+    cvector_pop_back(v);
+    cvector_shrink_to_fit(v);
+    ASSERT_EQ(cvector_capacity(v), (size_t)4);
+    cvector_push_back(v, 3);
+
+    /* the fifth element moves the vector to the heap */
+    cvector_push_back(v, 4);
+    ASSERT_TRUE(cvector_owns_storage(v));
+    ASSERT_EQ(cvector_size(v), (size_t)5);
+    for (i = 0; i < 5; ++i) {
+        ASSERT_EQ(v[i], i);
+    }
+    cvector_free(v);
+
+    /* destructors still run for elements in inline storage */
+    cvector_init_inline(str_v, str_storage, free_elem);
+    cvector_push_back(str_v, strdup("hello"));
+    cvector_push_back(str_v, strdup("world"));
+    ASSERT_FALSE(cvector_owns_storage(str_v));
+    cvector_free(str_v);
+
+    /* element types aligned more strictly than the metadata are padded into place */
+    cvector_init_inline(wide, wide_storage, NULL);
+    ASSERT_EQ(cvector_capacity(wide), (size_t)2);
+    ASSERT_EQ(((size_t)wide & 63), (size_t)0);
+    w.value = 1.5;
+    cvector_push_back(wide, w);
+    cvector_push_back(wide, w);
+    ASSERT_FALSE(cvector_owns_storage(wide));
+    ASSERT_EQ(wide[1].value, 1.5);
+    cvector_free(wide);
+}
+
+static size_t round_to_64(void *ctx, size_t size) {
+    (void)ctx;
+    return (size + 63) & ~(size_t)63;
+}
+
+UTEST(test, vector_growth_policy) {
+    cvector_allocator_t alloc          = {counting_malloc, counting_realloc, counting_free, NULL, round_to_64};
+    struct counting_allocator_t counts = {0, 0, 0, 0};
+    cvector_vector_type(char) v        = NULL;
+
+    ASSERT_EQ(cvector_growth_linear(4), 5);
+    ASSERT_EQ(cvector_growth_double(0), 1);
+    ASSERT_EQ(cvector_growth_double(4), 8);
+    ASSERT_EQ(cvector_growth_1_5(0), 1);
+    ASSERT_EQ(cvector_growth_1_5(1), 2);
+    ASSERT_EQ(cvector_growth_1_5(10), 15);
+
+    /* the hybrid policy doubles below the threshold and adds fixed chunks above it */
+    ASSERT_EQ(cvector_growth_hybrid((size_t)16, (size_t)8), (size_t)32);
+    ASSERT_EQ(cvector_growth_hybrid(CVECTOR_HYBRID_GROWTH_THRESHOLD / 8, (size_t)8), CVECTOR_HYBRID_GROWTH_THRESHOLD / 8 + CVECTOR_HYBRID_GROWTH_CHUNK / 8);
+    ASSERT_EQ(cvector_growth_hybrid((size_t)1, CVECTOR_HYBRID_GROWTH_CHUNK * 2), (size_t)2);
+
+    /* growth fills the block the allocator really provides */
+    alloc.ctx = &counts;
+    cvector_init_with_allocator(v, 0, NULL, &alloc);
+    cvector_push_back(v, 'a');
+    ASSERT_EQ(cvector_block_size(v, cvector_capacity(v)), round_to_64(NULL, sizeof(cvector_metadata_t) + sizeof(const cvector_allocator_t *) + 1));
+    cvector_free(v);
+}
+
+UTEST(test, vector_aligned) {
+    int i;
+    cvector_vector_type(double) v = NULL;
+    cvector_vector_type(char) c   = NULL;
+
+    cvector_init_aligned(v, 0, 64, NULL);
+    ASSERT_EQ(cvector_alignment(v), (size_t)64);
+    ASSERT_EQ(((size_t)v & 63), (size_t)0);
+
+    /* every reallocation keeps the alignment */
+    for (i = 0; i < 1000; ++i) {
+        cvector_push_back(v, (double)i);
+        ASSERT_EQ(((size_t)v & 63), (size_t)0);
+    }
+    cvector_erase(v, 0);
+    cvector_shrink_to_fit(v);
+    ASSERT_EQ(((size_t)v & 63), (size_t)0);
+    ASSERT_EQ(cvector_size(v), (size_t)999);
+    for (i = 0; i < 999; ++i) {
+        ASSERT_EQ(v[i], (double)(i + 1));
+    }
+    cvector_free(v);
+
+    /* an alignment stricter than the metadata needs padding in front of it */
+    cvector_init_aligned(c, 3, 256, NULL);
+    ASSERT_EQ(((size_t)c & 255), (size_t)0);
+    for (i = 0; i < 300; ++i) {
+        cvector_push_back(c, (char)i);
+        ASSERT_EQ(((size_t)c & 255), (size_t)0);
+    }
+    ASSERT_EQ(c[299], (char)299);
+    cvector_free(c);
+
+    /* other vectors are unaffected */
+    c = NULL;
+    ASSERT_EQ(cvector_alignment(c), (size_t)1);
+    cvector_push_back(c, 'a');
+    ASSERT_EQ(cvector_alignment(c), (size_t)1);
+    cvector_free(c);
+}
+
+UTEST(test, vector_append_n) {
+    int i;
+    int src[100];
+    struct counting_allocator_t counts = {0, 0, 0, 0};
+    cvector_allocator_t alloc          = {counting_malloc, counting_realloc, counting_free, NULL, NULL};
+    cvector_vector_type(int) v         = NULL;
+    cvector_vector_type(int) w         = NULL;
+
+    for (i = 0; i < 100; ++i) {
+        src[i] = i;
+    }
+
+    /* appending to a NULL vector allocates it */
+    cvector_append_n(v, src, 10);
+    ASSERT_EQ(cvector_size(v), (size_t)10);
+    cvector_append_n(v, src, 0);
+    ASSERT_EQ(cvector_size(v), (size_t)10);
+
+    /* a whole batch costs at most one reallocation */
+    alloc.ctx = &counts;
+    cvector_init_with_allocator(w, 0, NULL, &alloc);
+    cvector_append_n(w, src + 10, 90);
+    ASSERT_EQ(counts.reallocs, (size_t)1);
+    ASSERT_EQ(cvector_size(w), (size_t)90);
+
+    cvector_push_back_range(v, cvector_begin(w), cvector_end(w));
+    ASSERT_EQ(cvector_size(v), (size_t)100);
+    for (i = 0; i < 100; ++i) {
+        ASSERT_EQ(v[i], i);
+    }
+
+    cvector_free(w);
+    cvector_free(v);
+}
+
+UTEST(test, vector_insert_range) {
+    int i;
+    int src[]                          = {100, 101, 102};
+    struct counting_allocator_t counts = {0, 0, 0, 0};
+    cvector_allocator_t alloc          = {counting_malloc, counting_realloc, counting_free, NULL, NULL};
+    cvector_vector_type(int) v         = NULL;
+
+    alloc.ctx = &counts;
+    cvector_init_with_allocator(v, 0, NULL, &alloc);
+    for (i = 0; i < 4; ++i) {
+        cvector_push_back(v, i);
+    }
+    counts.reallocs = 0;
+
+    /* 0 1 [-1 -1 -1 -1 -1] 2 3 */
+    cvector_insert_n(v, 2, 5, -1);
+    ASSERT_EQ(counts.reallocs, (size_t)1);
+    ASSERT_EQ(cvector_size(v), (size_t)9);
+    ASSERT_EQ(v[1], 1);
+    for (i = 2; i < 7; ++i) {
+        ASSERT_EQ(v[i], -1);
+    }
+    ASSERT_EQ(v[7], 2);
+    ASSERT_EQ(v[8], 3);
+
+    /* [100 101 102] 0 1 ... */
+    cvector_insert_range(v, 0, src, src + 3);
+    ASSERT_EQ(cvector_size(v), (size_t)12);
+    ASSERT_EQ(v[0], 100);
+    ASSERT_EQ(v[2], 102);
+    ASSERT_EQ(v[3], 0);
+    ASSERT_EQ(v[11], 3);
+
+    /* inserting at the end appends */
+    cvector_insert_range(v, cvector_size(v), src, src + 3);
+    ASSERT_EQ(cvector_size(v), (size_t)15);
+    ASSERT_EQ(v[14], 102);
+
+    /* empty ranges are no-ops */
+    cvector_insert_n(v, 0, 0, 7);
+    cvector_insert_range(v, 0, src, src);
+    ASSERT_EQ(cvector_size(v), (size_t)15);
+    ASSERT_EQ(v[0], 100);
+
+    cvector_free(v);
+}
+
+static size_t destroyed_count;
+
+static void count_destroyed(void *ptr) {
+    (void)ptr;
+    ++destroyed_count;
+}
+
+UTEST(test, vector_erase_range) {
+    int i;
+    cvector_vector_type(int) v        = NULL;
+    cvector_vector_type(char *) str_v = NULL;
+
+    cvector_init(v, 10, count_destroyed);
+    for (i = 0; i < 10; ++i) {
+        cvector_push_back(v, i);
+    }
+
+    /* 0 1 [2 3 4] 5 6 7 8 9 */
+    destroyed_count = 0;
+    cvector_erase_range(v, 2, 5);
+    ASSERT_EQ(destroyed_count, (size_t)3);
+    ASSERT_EQ(cvector_size(v), (size_t)7);
+    ASSERT_EQ(v[1], 1);
+    ASSERT_EQ(v[2], 5);
+    ASSERT_EQ(v[6], 9);
+
+    /* empty and out of range spans are ignored */
+    cvector_erase_range(v, 3, 3);
+    cvector_erase_range(v, 5, 8);
+    ASSERT_EQ(destroyed_count, (size_t)3);
+    ASSERT_EQ(cvector_size(v), (size_t)7);
+
+    /* 0 1 5 6 [7 8 9] */
+    cvector_truncate(v, 4);
+    ASSERT_EQ(destroyed_count, (size_t)6);
+    ASSERT_EQ(cvector_size(v), (size_t)4);
+    ASSERT_EQ(cvector_capacity(v), (size_t)10);
+    cvector_truncate(v, 4);
+    cvector_truncate(v, 100);
+    ASSERT_EQ(cvector_size(v), (size_t)4);
+
+    /* resize shrinks by truncating */
+    cvector_resize(v, 1, 0);
+    ASSERT_EQ(destroyed_count, (size_t)9);
+    ASSERT_EQ(v[0], 0);
+    cvector_free(v);
+    ASSERT_EQ(destroyed_count, (size_t)10);
+
+    /* the removed elements are destroyed, the remaining ones are kept */
+    cvector_init(str_v, 4, free_elem);
+    cvector_push_back(str_v, strdup("a"));
+    cvector_push_back(str_v, strdup("b"));
+    cvector_push_back(str_v, strdup("c"));
+    cvector_push_back(str_v, strdup("d"));
+    cvector_erase_range(str_v, 0, 2);
+    ASSERT_STREQ(str_v[0], "c");
+    cvector_truncate(str_v, 1);
+    ASSERT_STREQ(str_v[0], "c");
+    cvector_free(str_v);
+}
+
+#define is_odd(x) ((x) % 2 != 0)
+
+UTEST(test, vector_remove_if) {
+    int i;
+    cvector_vector_type(int) v = NULL;
+
+    cvector_init(v, 10, count_destroyed);
+    for (i = 0; i < 10; ++i) {
+        cvector_push_back(v, i);
+    }
+
+    /* the last element fills the hole */
+    destroyed_count = 0;
+    cvector_erase_unordered(v, 2);
+    ASSERT_EQ(destroyed_count, (size_t)1);
+    ASSERT_EQ(cvector_size(v), (size_t)9);
+    ASSERT_EQ(v[2], 9);
+    ASSERT_EQ(v[8], 8);
+
+    /* erasing the last element needs no move */
+    cvector_erase_unordered(v, 8);
+    ASSERT_EQ(cvector_size(v), (size_t)8);
+    ASSERT_EQ(v[7], 7);
+    cvector_erase_unordered(v, 8);
+    ASSERT_EQ(cvector_size(v), (size_t)8);
+
+    /* 0 1 9 3 4 5 6 7 -> 0 4 6 */
+    cvector_remove_if(v, is_odd);
+    ASSERT_EQ(destroyed_count, (size_t)7);
+    ASSERT_EQ(cvector_size(v), (size_t)3);
+    ASSERT_EQ(v[0], 0);
+    ASSERT_EQ(v[1], 4);
+    ASSERT_EQ(v[2], 6);
+
+    cvector_free(v);
+}
+
+struct record_t {
+    int id;
+    char name[200];
+};
+
+UTEST(test, vector_emplace) {
+    int i;
+    struct record_t *slot;
+    cvector_vector_type(struct record_t) v = NULL;
+
+    for (i = 0; i < 100; ++i) {
+        cvector_emplace_back(v, slot);
+        slot->id      = i;
+        slot->name[0] = 'a';
+    }
+    ASSERT_EQ(cvector_size(v), (size_t)100);
+    ASSERT_TRUE(slot == &v[99]);
+    for (i = 0; i < 100; ++i) {
+        ASSERT_EQ(v[i].id, i);
+    }
+
+    cvector_emplace(v, 1, slot);
+    slot->id = -1;
+    ASSERT_EQ(cvector_size(v), (size_t)101);
+    ASSERT_TRUE(slot == &v[1]);
+    ASSERT_EQ(v[0].id, 0);
+    ASSERT_EQ(v[1].id, -1);
+    ASSERT_EQ(v[2].id, 1);
+    ASSERT_EQ(v[100].id, 99);
+
+    cvector_free(v);
+}
+
+UTEST(test, vector_resize_zero) {
+    size_t i;
+    cvector_vector_type(int) v = NULL;
+    cvector_vector_type(int) w = NULL;
+
+    /* a fresh vector comes from calloc */
+    cvector_resize_zero(v, 1000);
+    ASSERT_EQ(cvector_size(v), (size_t)1000);
+    ASSERT_EQ(cvector_capacity(v), (size_t)1000);
+    for (i = 0; i < 1000; ++i) {
+        ASSERT_EQ(v[i], 0);
+    }
+
+    /* existing elements are kept, new ones are cleared */
+    for (i = 0; i < 1000; ++i) {
+        v[i] = -1;
+    }
+    cvector_truncate(v, 10);
+    cvector_resize_zero(v, 2000);
+    ASSERT_EQ(cvector_size(v), (size_t)2000);
+    ASSERT_EQ(v[9], -1);
+    for (i = 10; i < 2000; ++i) {
+        ASSERT_EQ(v[i], 0);
+    }
+
+    /* an emptied vector keeps its destructor when its block is replaced */
+    cvector_clear(v);
+    cvector_set_elem_destructor(v, count_destroyed);
+    cvector_resize_zero(v, 4000);
+    ASSERT_EQ(cvector_size(v), (size_t)4000);
+    ASSERT_EQ(v[3999], 0);
+    ASSERT_TRUE(cvector_elem_destructor(v) == count_destroyed);
+    destroyed_count = 0;
+    cvector_resize_zero(v, 1);
+    ASSERT_EQ(destroyed_count, (size_t)3999);
+    cvector_free(v);
+
+    /* uninitialized resize only adjusts the size */
+    cvector_resize_uninit(w, 100);
+    ASSERT_EQ(cvector_size(w), (size_t)100);
+    for (i = 0; i < 100; ++i) {
+        w[i] = (int)i;
+    }
+    cvector_resize_uninit(w, 50);
+    cvector_resize_uninit(w, 60);
+    ASSERT_EQ(cvector_size(w), (size_t)60);
+    ASSERT_EQ(cvector_capacity(w), (size_t)100);
+    ASSERT_EQ(w[49], 49);
+    cvector_free(w);
+}
+
+UTEST(test, vector_move) {
+    int i;
+    int *data;
+    int *first;
+    void *block;
+    cvector_inline_storage(int, 4) storage;
+    cvector_vector_type(int) a = NULL;
+    cvector_vector_type(int) b = NULL;
+
+    for (i = 0; i < 10; ++i) {
+        cvector_push_back(a, i);
+    }
+    cvector_push_back(b, -1);
+
+    /* b drops its old contents and takes over a's block */
+    first = a;
+    cvector_move(b, a);
+    ASSERT_TRUE(a == NULL);
+    ASSERT_TRUE(b == first);
+    ASSERT_EQ(cvector_size(b), (size_t)10);
+
+    /* release hands out the elements in place */
+    cvector_release(b, data, block);
+    ASSERT_TRUE(b == NULL);
+    ASSERT_TRUE(data == first);
+    ASSERT_TRUE((void *)((char *)block + CVECTOR_HEADER_SIZE) == (void *)data);
+    for (i = 0; i < 10; ++i) {
+        ASSERT_EQ(data[i], i);
+    }
+
+    /* and adopt turns the block back into a vector, also in place */
+    cvector_adopt(a, block, 10, NULL);
+    ASSERT_TRUE(a == first);
+    ASSERT_EQ(cvector_size(a), (size_t)10);
+    ASSERT_EQ(cvector_capacity(a), (size_t)10);
+    for (i = 0; i < 10; ++i) {
+        ASSERT_EQ(a[i], i);
+    }
+    cvector_push_back(a, 10);
+    ASSERT_EQ(a[10], 10);
+    cvector_free(a);
+    a = NULL;
+
+    /* a block filled by the caller */
+    block = cvector_clib_malloc(CVECTOR_HEADER_SIZE + 3 * sizeof(int));
+    data  = (int *)(void *)((char *)block + CVECTOR_HEADER_SIZE);
+    for (i = 0; i < 3; ++i) {
+        data[i] = i * 2;
+    }
+    cvector_adopt(a, block, 3, NULL);
+    ASSERT_TRUE(a == data);
+    ASSERT_EQ(a[2], 4);
+    cvector_free(a);
+
+    /* vectors in caller provided storage hand out a copy */
+    cvector_init_inline(b, storage, NULL);
+    cvector_push_back(b, 42);
+    cvector_release(b, data, block);
+    ASSERT_TRUE((void *)data != (void *)(storage.bytes + CVECTOR_HEADER_SIZE));
+    ASSERT_TRUE((void *)data == block);
+    ASSERT_EQ(data[0], 42);
+    cvector_clib_free(block);
+
+    cvector_release(b, data, block);
+    ASSERT_TRUE(data == NULL);
+    ASSERT_TRUE(block == NULL);
+}
+
+UTEST(test, vector_mmap) {
+    size_t i;
+    size_t used;
+    const size_t page_size     = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t n             = 4 * CVECTOR_MMAP_THRESHOLD / sizeof(int);
+    cvector_vector_type(int) v = NULL;
+
+    cvector_init_mmap(v, 0, NULL);
+    ASSERT_TRUE(cvector_allocator(v) == &cvector_mmap_allocator);
+
+    /* small vectors come from the C library, large ones are mapped */
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (int)i);
+    }
+    ASSERT_EQ(((size_t)cvector_vec_to_block(v) & (page_size - 1)), (size_t)0);
+
+    /* and the capacity covers every page of the mapping */
+    used = cvector_block_size(v, cvector_capacity(v));
+    ASSERT_TRUE(used + sizeof(int) > ((used + page_size - 1) & ~(page_size - 1)));
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(v[i], (int)i);
+    }
+
+    /* shrinking below the threshold moves the vector back to the heap */
+    cvector_truncate(v, 16);
+    cvector_shrink_to_fit(v);
+    ASSERT_EQ(cvector_capacity(v), (size_t)16);
+    for (i = 0; i < 16; ++i) {
+        ASSERT_EQ(v[i], (int)i);
+    }
+    cvector_free(v);
+}
+
+UTEST(test, vector_huge) {
+    size_t i;
+    const size_t n                = 3 * CVECTOR_HUGEPAGE_THRESHOLD / sizeof(double);
+    cvector_vector_type(double) v = NULL;
+
+    cvector_init_huge(v, 0, NULL);
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (double)i);
+        if (cvector_block_size(v, cvector_capacity(v)) >= CVECTOR_HUGEPAGE_THRESHOLD) {
+            ASSERT_EQ(((size_t)cvector_vec_to_block(v) & (CVECTOR_HUGEPAGE_SIZE - 1)), (size_t)0);
+        }
+    }
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(v[i], (double)i);
+    }
+
+    /* shrinking keeps the alignment */
+    cvector_truncate(v, n / 2);
+    cvector_shrink_to_fit(v);
+    ASSERT_EQ(((size_t)cvector_vec_to_block(v) & (CVECTOR_HUGEPAGE_SIZE - 1)), (size_t)0);
+    ASSERT_EQ(v[n / 2 - 1], (double)(n / 2 - 1));
+
+    /* and so does going below the threshold and back */
+    cvector_truncate(v, 16);
+    cvector_shrink_to_fit(v);
+    cvector_reserve(v, n);
+    ASSERT_EQ(((size_t)cvector_vec_to_block(v) & (CVECTOR_HUGEPAGE_SIZE - 1)), (size_t)0);
+    ASSERT_EQ(v[15], 15.0);
+    cvector_free(v);
+}
+
+UTEST(test, vector_vm) {
+    size_t i;
+    int *first;
+    int *elem;
+    cvector_vm_t vm;
+    size_t n                   = 4 * CVECTOR_MMAP_THRESHOLD / sizeof(int);
+    cvector_vector_type(int) v = NULL;
+    cvector_vector_type(int) w = NULL;
+
+    cvector_vm_init(&vm, 64 * CVECTOR_MMAP_THRESHOLD);
+    cvector_init_vm(v, 0, NULL, &vm);
+    cvector_push_back(v, 0);
+    first = v;
+    elem  = &v[0];
+
+    /* growing commits more pages but never moves the vector */
+    for (i = 1; i < n; ++i) {
+        cvector_push_back(v, (int)i);
+        ASSERT_TRUE(v == first);
+    }
+    ASSERT_EQ(*elem, 0);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(v[i], (int)i);
+    }
+
+    /* neither does shrinking */
+    cvector_truncate(v, 10);
+    cvector_shrink_to_fit(v);
+    ASSERT_TRUE(v == first);
+    ASSERT_EQ(v[9], 9);
+    cvector_reserve(v, n);
+    ASSERT_TRUE(v == first);
+    ASSERT_EQ(v[9], 9);
+    cvector_free(v);
+
+    /* the last step of growth takes the rest of the reserve, even when
+     * doubling would ask for more */
+    v = NULL;
+    cvector_vm_init(&vm, 1536 * 1024);
+    cvector_init_vm(v, 0, NULL, &vm);
+    first = v;
+    n     = (vm.reserve - sizeof(const cvector_allocator_t *) - sizeof(cvector_metadata_t)) / sizeof(int);
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (int)i);
+        ASSERT_TRUE(v == first);
+    }
+    ASSERT_EQ(cvector_size(v), n);
+    ASSERT_EQ(cvector_capacity(v), n);
+    ASSERT_EQ(v[n - 1], (int)(n - 1));
+    cvector_free(v);
+
+    /* the shared allocator uses the default reservation */
+    cvector_init_with_allocator(w, 16, NULL, &cvector_vm_allocator);
+    cvector_push_back(w, 1);
+    cvector_free(w);
+}
+
+/* a fresh file under the temp directory, removed however the test ends */
+struct temp_file {
+    char path[512];
+};
+
+UTEST_F_SETUP(temp_file) {
+    const char *dir = getenv("TMPDIR");
+    int fd;
+    if (!dir || !*dir) {
+        dir = "/tmp";
+    }
+    ASSERT_LT(strlen(dir) + sizeof("/unit-tests-XXXXXX.cvec"), sizeof(utest_fixture->path));
+    strcpy(utest_fixture->path, dir);
+    strcat(utest_fixture->path, "/unit-tests-XXXXXX.cvec");
+    fd = mkstemps(utest_fixture->path, 5);
+    ASSERT_NE(fd, -1);
+    close(fd);
+}
+
+UTEST_F_TEARDOWN(temp_file) {
+    (void)utest_result;
+    remove(utest_fixture->path);
+}
+
+UTEST_F(temp_file, vector_map_file) {
+    size_t i;
+    const char *path            = utest_fixture->path;
+    const size_t n              = 100000;
+    cvector_vector_type(int) v  = NULL;
+    cvector_vector_type(int) m  = NULL;
+    cvector_vector_type(char) c = NULL;
+
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (int)i);
+    }
+    ASSERT_EQ(cvector_save(v, path), 0);
+
+    /* read only mappings look like any other vector */
+    ASSERT_TRUE(cvector_map_file(m, path, CVECTOR_MAP_READONLY));
+    ASSERT_EQ(cvector_size(m), n);
+    ASSERT_EQ(cvector_capacity(m), n);
+    ASSERT_EQ(((size_t)m & 4095), (size_t)0);
+    ASSERT_EQ(memcmp(m, v, n * sizeof(int)), 0);
+    cvector_free(m);
+
+    /* private mappings are copy-on-write and can grow */
+    ASSERT_TRUE(cvector_map_file(m, path, CVECTOR_MAP_PRIVATE));
+    m[0] = -1;
+    cvector_push_back(m, -2);
+    ASSERT_EQ(cvector_size(m), n + 1);
+    ASSERT_EQ(m[0], -1);
+    ASSERT_EQ(m[n - 1], (int)(n - 1));
+    ASSERT_EQ(m[n], -2);
+    cvector_free(m);
+
+    /* the file is untouched */
+    ASSERT_TRUE(cvector_map_file(m, path, CVECTOR_MAP_READONLY));
+    ASSERT_EQ(cvector_size(m), n);
+    ASSERT_EQ(m[0], 0);
+    cvector_free(m);
+
+    /* the element size must match */
+    ASSERT_FALSE(cvector_map_file(c, path, CVECTOR_MAP_READONLY));
+    ASSERT_TRUE(c == NULL);
+
+    /* empty vectors round trip too */
+    cvector_clear(v);
+    ASSERT_EQ(cvector_save(v, path), 0);
+    ASSERT_TRUE(cvector_map_file(m, path, CVECTOR_MAP_PRIVATE));
+    ASSERT_EQ(cvector_size(m), (size_t)0);
+    cvector_push_back(m, 7);
+    ASSERT_EQ(m[0], 7);
+    cvector_free(m);
+
+    cvector_free(v);
+}
+
+UTEST(test, vector_stream) {
+    size_t i;
+    const size_t n                = 3 * CVECTOR_STREAM_CHUNK_SIZE / sizeof(double) + 5;
+    cvector_vector_type(double) v = NULL;
+    cvector_vector_type(double) r = NULL;
+    cvector_vector_type(int) e    = NULL;
+    FILE *file                    = tmpfile();
+    long pos;
+    int ch;
+
+    ASSERT_TRUE(file != NULL);
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (double)i * 0.5);
+    }
+
+    /* round trip through a stream, the result is sized exactly */
+    ASSERT_EQ(cvector_write_stream(v, file), 0);
+    rewind(file);
+    ASSERT_TRUE(cvector_read_stream(r, file));
+    ASSERT_EQ(cvector_size(r), n);
+    ASSERT_EQ(cvector_capacity(r), n);
+    ASSERT_EQ(memcmp(r, v, n * sizeof(double)), 0);
+    cvector_push_back(r, 1.0);
+    ASSERT_EQ(cvector_size(r), n + 1);
+    cvector_free(r);
+
+    /* the element size must match */
+    rewind(file);
+    ASSERT_FALSE(cvector_read_stream(e, file));
+    ASSERT_TRUE(e == NULL);
+
+    /* a corrupted chunk fails the checksum */
+    pos = CVECTOR_STREAM_HEADER_SIZE + CVECTOR_STREAM_CHUNK_SIZE + 4 + 100;
+    ASSERT_EQ(fseek(file, pos, SEEK_SET), 0);
+    ch = fgetc(file);
+    ASSERT_EQ(fseek(file, pos, SEEK_SET), 0);
+    fputc(ch ^ 0x40, file);
+    rewind(file);
+    ASSERT_FALSE(cvector_read_stream(r, file));
+    ASSERT_TRUE(r == NULL);
+    fclose(file);
+
+    /* file descriptors work the same, including empty vectors */
+    file = tmpfile();
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(cvector_write_fd(v, fileno(file)), 0);
+    cvector_clear(v);
+    ASSERT_EQ(cvector_write_fd(v, fileno(file)), 0);
+    ASSERT_EQ(lseek(fileno(file), 0, SEEK_SET), (off_t)0);
+    ASSERT_TRUE(cvector_read_fd(r, fileno(file)));
+    ASSERT_EQ(cvector_size(r), n);
+    ASSERT_EQ(r[n - 1], (double)(n - 1) * 0.5);
+    cvector_free(r);
+    ASSERT_TRUE(cvector_read_fd(r, fileno(file)));
+    ASSERT_TRUE(r != NULL);
+    ASSERT_EQ(cvector_size(r), (size_t)0);
+    cvector_free(r);
+
+    /* and running out of data is an error */
+    ASSERT_FALSE(cvector_read_fd(r, fileno(file)));
+    fclose(file);
+
+    cvector_free(v);
+}
+
+UTEST(test, vector_segmented) {
+    size_t i;
+    int *first;
+    int *elem;
+    cvector_segmented_type(int) s = NULL;
+    cvector_segmented_type(int) d = NULL;
+    const size_t len              = CVECTOR_SEGMENT_BYTES / sizeof(int);
+    const size_t n                = 3 * len + 7;
+
+    ASSERT_EQ(cvector_segmented_size(s), (size_t)0);
+    ASSERT_TRUE(cvector_segmented_empty(s));
+    ASSERT_TRUE(cvector_segmented_at(s, 0) == NULL);
+
+    cvector_segmented_push_back(s, 0);
+    first = cvector_segmented_at(s, 0);
+    for (i = 1; i < n; ++i) {
+        cvector_segmented_push_back(s, (int)i);
+    }
+
+    /* growing never moves an element */
+    ASSERT_TRUE(cvector_segmented_at(s, 0) == first);
+    ASSERT_EQ(cvector_segmented_size(s), n);
+    ASSERT_EQ(cvector_segmented_block_count(s), (size_t)4);
+    ASSERT_EQ(cvector_segmented_capacity(s), 4 * len);
+    for (i = 0; i < n; ++i) {
+        elem = cvector_segmented_at(s, i);
+        ASSERT_EQ(*elem, (int)i);
+    }
+    ASSERT_TRUE(cvector_segmented_at(s, n) == NULL);
+    elem = cvector_segmented_back(s);
+    ASSERT_EQ(*elem, (int)(n - 1));
+
+    /* popping across a block boundary releases the empty block */
+    for (i = 0; i < 8; ++i) {
+        cvector_segmented_pop_back(s);
+    }
+    ASSERT_EQ(cvector_segmented_size(s), 3 * len - 1);
+    ASSERT_EQ(cvector_segmented_block_count(s), (size_t)3);
+    elem = cvector_segmented_back(s);
+    ASSERT_EQ(*elem, (int)(3 * len - 2));
+    cvector_segmented_push_back(s, -1);
+    cvector_segmented_push_back(s, -2);
+    elem = cvector_segmented_at(s, 3 * len - 1);
+    ASSERT_EQ(*elem, -1);
+    elem = cvector_segmented_at(s, 3 * len);
+    ASSERT_EQ(*elem, -2);
+
+    cvector_segmented_clear(s);
+    ASSERT_TRUE(cvector_segmented_empty(s));
+    ASSERT_EQ(cvector_segmented_block_count(s), (size_t)1);
+
+    /* popping an empty segmented vector does nothing */
+    cvector_segmented_pop_back(s);
+    ASSERT_TRUE(cvector_segmented_empty(s));
+    cvector_segmented_pop_back(d);
+    ASSERT_TRUE(d == NULL);
+    cvector_segmented_free(s);
+
+    /* every block destroys its elements */
+    destroyed_count = 0;
+    cvector_segmented_init(d, count_destroyed);
+    for (i = 0; i < n; ++i) {
+        cvector_segmented_push_back(d, (int)i);
+    }
+    cvector_segmented_pop_back(d);
+    ASSERT_EQ(destroyed_count, (size_t)1);
+    cvector_segmented_free(d);
+    ASSERT_EQ(destroyed_count, n);
+}
+
+UTEST(test, vector_deque) {
+    size_t i;
+    int *elem;
+    cvector_deque_type(int) q = NULL;
+    cvector_deque_type(int) d = NULL;
+
+    ASSERT_TRUE(cvector_deque_front(q) == NULL);
+    ASSERT_EQ(cvector_size(q), (size_t)0);
+
+    /* a FIFO which keeps wrapping around a small ring */
+    cvector_deque_init(q, 4, NULL);
+    for (i = 0; i < 1000; ++i) {
+        cvector_deque_push_back(q, (int)i);
+        cvector_deque_push_back(q, (int)i);
+        elem = cvector_deque_front(q);
+        ASSERT_EQ(*elem, (int)(i / 2));
+        cvector_deque_pop_front(q);
+    }
+    ASSERT_EQ(cvector_size(q), (size_t)1000);
+    for (i = 0; i < 1000; ++i) {
+        elem = cvector_deque_at(q, i);
+        ASSERT_EQ(*elem, (int)((1000 + i) / 2));
+    }
+    ASSERT_TRUE(cvector_deque_at(q, 1000) == NULL);
+    cvector_deque_clear(q);
+    ASSERT_TRUE(cvector_empty(q));
+
+    /* both ends, wrapped so that the elements are split in two segments */
+    for (i = 0; i < 3; ++i) {
+        cvector_deque_push_back(q, (int)i);
+    }
+    for (i = 1; i <= 3; ++i) {
+        cvector_deque_push_front(q, -(int)i);
+    }
+    ASSERT_EQ(cvector_size(q), (size_t)6);
+    ASSERT_EQ(cvector_deque_segment1_size(q) + cvector_deque_segment2_size(q), (size_t)6);
+    ASSERT_TRUE(cvector_deque_segment2_size(q) > 0);
+    for (i = 0; i < 6; ++i) {
+        elem = cvector_deque_at(q, i);
+        ASSERT_EQ(*elem, (int)i - 3);
+    }
+    elem = cvector_deque_back(q);
+    ASSERT_EQ(*elem, 2);
+    cvector_deque_pop_back(q);
+    elem = cvector_deque_back(q);
+    ASSERT_EQ(*elem, 1);
+
+    /* growing a wrapped ring keeps the order */
+    cvector_deque_reserve(q, 4096);
+    ASSERT_EQ(cvector_capacity(q), (size_t)4096);
+    ASSERT_EQ(cvector_deque_segment2_size(q), (size_t)0);
+    for (i = 0; i < 5; ++i) {
+        elem = cvector_deque_at(q, i);
+        ASSERT_EQ(*elem, (int)i - 3);
+    }
+    cvector_deque_free(q);
+
+    /* destructors run from every removal path */
+    destroyed_count = 0;
+    cvector_deque_init(d, 2, count_destroyed);
+    for (i = 0; i < 10; ++i) {
+        cvector_deque_push_front(d, (int)i);
+    }
+    cvector_deque_pop_front(d);
+    cvector_deque_pop_back(d);
+    ASSERT_EQ(destroyed_count, (size_t)2);
+    cvector_deque_free(d);
+    ASSERT_EQ(destroyed_count, (size_t)10);
+
+    /* popping an empty deque does nothing */
+    d = NULL;
+    cvector_deque_pop_front(d);
+    cvector_deque_pop_back(d);
+    ASSERT_TRUE(d == NULL);
+    cvector_deque_init(d, 2, count_destroyed);
+    cvector_deque_push_back(d, 1);
+    cvector_deque_pop_back(d);
+    cvector_deque_pop_back(d);
+    cvector_deque_pop_front(d);
+    ASSERT_EQ(cvector_size(d), (size_t)0);
+    ASSERT_EQ(destroyed_count, (size_t)11);
+    cvector_deque_push_back(d, 2);
+    elem = cvector_deque_front(d);
+    ASSERT_EQ(*elem, 2);
+    elem = cvector_deque_back(d);
+    ASSERT_EQ(*elem, 2);
+    cvector_deque_free(d);
+}
+
+#define SPSC_COUNT 200000
+
+static void *spsc_producer(void *arg) {
+    cvector_spsc_type(int) q = (int *)arg;
+    int batch[7];
+    int next = 0;
+    int ok;
+    size_t pushed;
+    size_t i;
+
+    /* one at a time for the first half, then in batches */
+    while (next < SPSC_COUNT / 2) {
+        cvector_spsc_push(q, next, ok);
+        if (ok) {
+            ++next;
+        } else {
+            sched_yield();
+        }
+    }
+    while (next < SPSC_COUNT) {
+        for (i = 0; i < 7; ++i) {
+            batch[i] = next + (int)i;
+        }
+        cvector_spsc_push_n(q, batch, (SPSC_COUNT - next < 7 ? (size_t)(SPSC_COUNT - next) : 7), pushed);
+        if (pushed) {
+            next += (int)pushed;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+UTEST(test, vector_spsc) {
+    cvector_spsc_type(int) q = NULL;
+    pthread_t producer;
+    int batch[5];
+    int expected = 0;
+    int value    = 0;
+    int ok;
+    size_t popped;
+    size_t i;
+
+    ASSERT_EQ(cvector_spsc_capacity(q), (size_t)0);
+    cvector_spsc_init(q, 1000);
+    ASSERT_EQ(cvector_spsc_capacity(q), (size_t)1024);
+    ASSERT_EQ(((size_t)q & (CVECTOR_CACHE_LINE - 1)), (size_t)0);
+
+    /* single threaded: full and empty, and batches which wrap */
+    cvector_spsc_pop(q, value, ok);
+    ASSERT_EQ(ok, 0);
+    for (i = 0; i < 1024; ++i) {
+        cvector_spsc_push(q, (int)i, ok);
+        ASSERT_EQ(ok, 1);
+    }
+    cvector_spsc_push(q, -1, ok);
+    ASSERT_EQ(ok, 0);
+    ASSERT_EQ(cvector_spsc_size(q), (size_t)1024);
+    for (i = 0; i < 1020; ++i) {
+        cvector_spsc_pop(q, value, ok);
+        ASSERT_EQ(value, (int)i);
+    }
+    for (i = 0; i < 5; ++i) {
+        batch[i] = 1024 + (int)i;
+    }
+    cvector_spsc_push_n(q, batch, 5, popped);
+    ASSERT_EQ(popped, (size_t)5);
+    cvector_spsc_pop_n(q, batch, 5, popped);
+    ASSERT_EQ(popped, (size_t)5);
+    for (i = 0; i < 5; ++i) {
+        ASSERT_EQ(batch[i], 1020 + (int)i);
+    }
+    cvector_spsc_pop_n(q, batch, 5, popped);
+    ASSERT_EQ(popped, (size_t)4);
+    ASSERT_EQ(batch[3], 1028);
+    ASSERT_EQ(cvector_spsc_size(q), (size_t)0);
+
+    /* a producer thread, the order must be kept */
+    ASSERT_EQ(pthread_create(&producer, NULL, spsc_producer, q), 0);
+    while (expected < SPSC_COUNT) {
+        cvector_spsc_pop_n(q, batch, 5, popped);
+        for (i = 0; i < popped; ++i) {
+            ASSERT_EQ(batch[i], expected);
+            ++expected;
+        }
+        cvector_spsc_pop(q, value, ok);
+        if (ok) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        }
+        if (!popped && !ok) {
+            sched_yield();
+        }
+    }
+    ASSERT_EQ(pthread_join(producer, NULL), 0);
+    cvector_spsc_free(q);
+}
+
+#define CONCURRENT_THREADS 8
+#define CONCURRENT_PUSHES  50000
+
+static cvector_concurrent_type(size_t) concurrent_results;
+
+static void *concurrent_appender(void *arg) {
+    const size_t id = (size_t)arg;
+    size_t i;
+    for (i = 0; i < CONCURRENT_PUSHES; ++i) {
+        cvector_concurrent_push_back(concurrent_results, id * CONCURRENT_PUSHES + i);
+    }
+    return NULL;
+}
+
+UTEST(test, vector_concurrent) {
+    pthread_t threads[CONCURRENT_THREADS];
+    size_t next[CONCURRENT_THREADS];
+    cvector_vector_type(size_t) flat = NULL;
+    cvector_concurrent_type(int) d   = NULL;
+    size_t *elem;
+    size_t i;
+
+    ASSERT_EQ(cvector_concurrent_size(concurrent_results), (size_t)0);
+    cvector_concurrent_init(concurrent_results, NULL);
+    ASSERT_TRUE(cvector_concurrent_empty(concurrent_results));
+
+    for (i = 0; i < CONCURRENT_THREADS; ++i) {
+        ASSERT_EQ(pthread_create(&threads[i], NULL, concurrent_appender, (void *)i), 0);
+    }
+    for (i = 0; i < CONCURRENT_THREADS; ++i) {
+        ASSERT_EQ(pthread_join(threads[i], NULL), 0);
+        next[i] = 0;
+    }
+    ASSERT_EQ(cvector_concurrent_seal(concurrent_results), (size_t)CONCURRENT_THREADS * CONCURRENT_PUSHES);
+    ASSERT_EQ(cvector_concurrent_size(concurrent_results), (size_t)CONCURRENT_THREADS * CONCURRENT_PUSHES);
+
+    /* every element is there once, and each thread's elements keep their order */
+    cvector_concurrent_copy(concurrent_results, flat);
+    ASSERT_EQ(cvector_size(flat), (size_t)CONCURRENT_THREADS * CONCURRENT_PUSHES);
+    for (i = 0; i < cvector_size(flat); ++i) {
+        const size_t id = flat[i] / CONCURRENT_PUSHES;
+        ASSERT_TRUE(id < CONCURRENT_THREADS);
+        ASSERT_EQ(flat[i], id * CONCURRENT_PUSHES + next[id]);
+        ++next[id];
+        elem = cvector_concurrent_at(concurrent_results, i);
+        ASSERT_EQ(*elem, flat[i]);
+    }
+    ASSERT_TRUE(cvector_concurrent_at(concurrent_results, cvector_size(flat)) == NULL);
+    cvector_free(flat);
+    cvector_concurrent_free(concurrent_results);
+
+    /* destructors run once per element */
+    destroyed_count = 0;
+    cvector_concurrent_init(d, count_destroyed);
+    for (i = 0; i < 3 * CVECTOR_CONCURRENT_FIRST_SEGMENT; ++i) {
+        cvector_concurrent_push_back(d, (int)i);
+    }
+    ASSERT_TRUE(d[1] != NULL);
+    ASSERT_TRUE(d[2] == NULL);
+    cvector_concurrent_free(d);
+    ASSERT_EQ(destroyed_count, (size_t)3 * CVECTOR_CONCURRENT_FIRST_SEGMENT);
+}
+
+static void parallel_scale(void *elem, void *ctx) {
+    *(int *)elem *= *(int *)ctx;
+}
+
+static void parallel_half(const void *in, void *out, void *ctx) {
+    (void)ctx;
+    *(double *)out = *(const int *)in / 2.0;
+}
+
+static void parallel_mark(void *arg, size_t first, size_t last) {
+    unsigned char *marks = (unsigned char *)arg;
+    for (; first < last; ++first) {
+        ++marks[first];
+    }
+}
+
+UTEST(test, vector_parallel) {
+    size_t i;
+    int factor                               = 3;
+    const size_t n                           = 1000003;
+    cvector_vector_type(int) v               = NULL;
+    cvector_vector_type(int) small           = NULL;
+    cvector_vector_type(double) h            = NULL;
+    cvector_vector_type(unsigned char) marks = NULL;
+    cvector_thread_pool_t *pool;
+
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (int)i);
+    }
+    cvector_parallel_for_each(v, parallel_scale, &factor);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(v[i], 3 * (int)i);
+    }
+
+    cvector_parallel_transform(v, h, parallel_half, NULL);
+    ASSERT_EQ(cvector_size(h), n);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(h[i], 1.5 * (double)i);
+    }
+
+    /* below the cutoff, and empty vectors */
+    cvector_push_back(small, 1);
+    cvector_push_back(small, 2);
+    cvector_parallel_for_each(small, parallel_scale, &factor);
+    ASSERT_EQ(small[1], 6);
+    cvector_clear(small);
+    cvector_parallel_transform(small, h, parallel_half, NULL);
+    ASSERT_EQ(cvector_size(h), (size_t)0);
+
+    /* an explicit pool, which covers every index exactly once */
+    pool = cvector_thread_pool_create(4);
+    ASSERT_TRUE(pool != NULL);
+    ASSERT_EQ(cvector_thread_pool_size(pool), (size_t)4);
+    cvector_resize_zero(marks, n);
+    for (i = 0; i < 10; ++i) {
+        cvector_parallel_run(pool, n, 1000, parallel_mark, marks);
+    }
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(marks[i], (unsigned char)10);
+    }
+    cvector_thread_pool_destroy(pool);
+
+    ASSERT_EQ(cvector_parallel_grain(sizeof(int)) * sizeof(int) / CVECTOR_CACHE_LINE * CVECTOR_CACHE_LINE, cvector_parallel_grain(sizeof(int)) * sizeof(int));
+
+    cvector_free(marks);
+    cvector_free(small);
+    cvector_free(h);
+    cvector_free(v);
+}
+
+static void parallel_max(void *acc, const void *elem) {
+    if (*(const int *)elem > *(int *)acc) {
+        *(int *)acc = *(const int *)elem;
+    }
+}
+
+static void parallel_add(void *acc, const void *elem) {
+    *(size_t *)acc += *(const size_t *)elem;
+}
+
+UTEST(test, vector_parallel_scan) {
+    size_t i;
+    int max;
+    size_t total;
+    size_t expected;
+    double fsum;
+    const size_t n                         = 1000003;
+    cvector_vector_type(int) v             = NULL;
+    cvector_vector_type(int) running       = NULL;
+    cvector_vector_type(size_t) lengths    = NULL;
+    cvector_vector_type(size_t) offsets    = NULL;
+    cvector_vector_type(size_t) serial     = NULL;
+    cvector_vector_type(unsigned char) b   = NULL;
+    cvector_vector_type(double) d          = NULL;
+    cvector_thread_pool_t *pool;
+
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(v, (int)((i * 7919) % 1000003));
+        cvector_push_back(lengths, i % 13);
+        cvector_push_back(b, (unsigned char)i);
+        cvector_push_back(d, 0.5);
+    }
+
+    /* serial references */
+    cvector_reserve(serial, n);
+    expected = 0;
+    for (i = 0; i < n; ++i) {
+        cvector_push_back(serial, expected);
+        expected += lengths[i];
+    }
+
+    /* the default pool, and an explicit one which splits every call into chunks */
+    pool = cvector_thread_pool_create(4);
+    ASSERT_TRUE(pool != NULL);
+
+    cvector_parallel_reduce(v, -1, parallel_max, max);
+    ASSERT_EQ(max, 1000002);
+    max = -1;
+    cvector_parallel_reduce_n(pool, v, n, sizeof(int), &max, parallel_max);
+    ASSERT_EQ(max, 1000002);
+
+    cvector_parallel_sum(lengths, (size_t)5, total);
+    ASSERT_EQ(total, expected + 5);
+    total = 5;
+    cvector_parallel_sum_n(pool, lengths, n, sizeof(size_t), &total);
+    ASSERT_EQ(total, expected + 5);
+    total = 0;
+    cvector_parallel_reduce_n(pool, lengths, n, sizeof(size_t), &total, parallel_add);
+    ASSERT_EQ(total, expected);
+
+    /* wraps around like the serial sum */
+    {
+        unsigned char bsum      = 0;
+        unsigned char bexpected = 0;
+        for (i = 0; i < n; ++i) {
+            bexpected = (unsigned char)(bexpected + b[i]);
+        }
+        cvector_parallel_sum_n(pool, b, n, 1, &bsum);
+        ASSERT_EQ(bsum, bexpected);
+    }
+
+    /* signed elements of the size of the widest kernel */
+    {
+        long long lsum                      = 0;
+        cvector_vector_type(long long) wide = NULL;
+        for (i = 0; i < n; ++i) {
+            cvector_push_back(wide, (long long)i - 500000);
+        }
+        cvector_parallel_sum(wide, 3LL, lsum);
+        ASSERT_EQ(lsum, (long long)n * ((long long)n - 1) / 2 - 500000LL * (long long)n + 3);
+        cvector_free(wide);
+    }
+
+    cvector_parallel_fsum(d, 1.0, fsum);
+    ASSERT_EQ(fsum, 1.0 + 0.5 * (double)n);
+    fsum = 1.0;
+    cvector_parallel_fsum_n(pool, d, n, sizeof(double), &fsum);
+    ASSERT_EQ(fsum, 1.0 + 0.5 * (double)n);
+
+    /* CSR row offsets from the row lengths */
+    cvector_exclusive_sum(lengths, offsets, (size_t)0);
+    ASSERT_EQ(cvector_size(offsets), n);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i]);
+    }
+    total = 0;
+    cvector_parallel_sum_scan_n(pool, lengths, offsets, n, sizeof(size_t), &total);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i]);
+    }
+    cvector_exclusive_scan(lengths, offsets, (size_t)0, parallel_add);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i]);
+    }
+    offsets[0] = 0;
+    cvector_parallel_scan_n(pool, lengths, offsets, n, sizeof(size_t), offsets, parallel_add);
+    for (i = 0; i < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i]);
+    }
+
+    /* inclusive scans, and in place */
+    cvector_inclusive_sum(lengths, offsets);
+    for (i = 0; i + 1 < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i + 1]);
+    }
+    ASSERT_EQ(offsets[n - 1], expected);
+    cvector_parallel_scan_n(pool, lengths, offsets, n, sizeof(size_t), NULL, parallel_add);
+    for (i = 0; i + 1 < n; ++i) {
+        ASSERT_EQ(offsets[i], serial[i + 1]);
+    }
+    cvector_parallel_sum_scan_n(pool, lengths, lengths, n, sizeof(size_t), NULL);
+    for (i = 0; i + 1 < n; ++i) {
+        ASSERT_EQ(lengths[i], serial[i + 1]);
+    }
+    ASSERT_EQ(lengths[n - 1], expected);
+    cvector_inclusive_scan(v, running, parallel_max);
+    ASSERT_EQ(cvector_size(running), n);
+    for (i = 1; i < n; ++i) {
+        ASSERT_TRUE(running[i] >= running[i - 1] && running[i] >= v[i]);
+    }
+    ASSERT_EQ(running[n - 1], 1000002);
+    cvector_thread_pool_destroy(pool);
+
+    /* small and empty vectors */
+    cvector_resize(lengths, 3, 2);
+    cvector_exclusive_sum(lengths, offsets, (size_t)1);
+    ASSERT_EQ(cvector_size(offsets), (size_t)3);
+    ASSERT_EQ(offsets[0], (size_t)1);
+    ASSERT_EQ(offsets[2], lengths[0] + lengths[1] + 1);
+    cvector_clear(lengths);
+    cvector_exclusive_sum(lengths, offsets, (size_t)1);
+    ASSERT_EQ(cvector_size(offsets), (size_t)0);
+    cvector_inclusive_scan(lengths, offsets, parallel_add);
+    ASSERT_EQ(cvector_size(offsets), (size_t)0);
+    cvector_parallel_sum(lengths, (size_t)7, total);
+    ASSERT_EQ(total, (size_t)7);
+
+    cvector_free(d);
+    cvector_free(b);
+    cvector_free(running);
+    cvector_free(serial);
+    cvector_free(offsets);
+    cvector_free(lengths);
+    cvector_free(v);
+}
+
 UTEST_MAIN();